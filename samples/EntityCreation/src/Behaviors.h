@@ -9,31 +9,31 @@
 
 #include "entityx/Entity.h"
 #include "Behavior.h"
+#include "CoroutineBehavior.h"
 
 namespace soso {
 
 /// Moves controlled entity while mouse is dragged.
-/// Calls optional callback when mouse is up; otherwise destroys entity.
+/// Calls optional callback with the final position and the last drag's movement when mouse is up; otherwise destroys entity.
 class DragTracker : public BehaviorBase {
 public:
-  using Callback = std::function<void (const ci::vec2&, const ci::vec2&)>;
+  using Callback = std::function<void (const ci::vec2 &position, const ci::vec2 &delta)>;
 
   DragTracker(entityx::Entity e)
   : BehaviorBase(e),
     _position(e.component<Position>()),
-    _mouse(_position->position),
-    _mouse_previous(_mouse)
+    _mouse(_position->position)
   {}
 
   void mouseDrag(const ci::app::MouseEvent &event) override {
-    _mouse_previous = _mouse;
     _mouse = event.getPos();
+    _mouse_delta = mouseDelta();
     _position->position = _mouse;
   }
 
   void mouseUp(const ci::app::MouseEvent &event) override {
     if (_mouse_up_callback) {
-      _mouse_up_callback(_mouse, _mouse_previous);
+      _mouse_up_callback(_mouse, _mouse_delta);
     }
     else {
       entity().destroy();
@@ -46,7 +46,31 @@ public:
 private:
   Callback _mouse_up_callback;
   entityx::ComponentHandle<Position> _position;
-  ci::vec2 _mouse, _mouse_previous;
+  ci::vec2 _mouse;
+  /// Movement covered by the latest drag, including every drag coalesced into it.
+  ci::vec2 _mouse_delta;
 };
 
+#if defined(__cpp_impl_coroutine)
+/// Flashes a thrown dot a few times, then leaves it alone.
+/// Written as a coroutine, so the steps read in order and the behavior sleeps between them instead of counting frames.
+/// Only available when the sample is built as C++20.
+class ThrowFlash : public CoroutineBehavior {
+public:
+  using CoroutineBehavior::CoroutineBehavior;
+
+  BehaviorTask run() override {
+    auto circle = entity().component<Circle>();
+    for (int i = 0; i < 3; i += 1) {
+      // Other code (e.g. fadeWithAge) changes the color over time, so restore what it was just before this flash.
+      auto color = circle->color;
+      circle->color = ci::Color::white();
+      co_await wait(0.1);
+      circle->color = color;
+      co_await wait(0.1);
+    }
+  }
+};
+#endif
+
 } // namespace soso
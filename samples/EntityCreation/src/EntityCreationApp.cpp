@@ -13,6 +13,7 @@
 #include "soso/ExpiresSystem.h"
 #include "soso/Behavior.h"
 #include "soso/BehaviorSystem.h"
+#include "soso/CommandBuffer.h"
 #include "Behaviors.h"
 
 using namespace ci;
@@ -43,6 +44,8 @@ private:
   entityx::EventManager   events;
   entityx::EntityManager entities;
   entityx::SystemManager systems;
+  /// Structural changes made while iterating, applied at the end of update.
+  soso::CommandBuffer    commands;
   uint32_t               num_dots = 0;
   static const uint32_t   max_dots = 1024;
 
@@ -121,11 +124,17 @@ void EntityCreationApp::mouseDown(MouseEvent event)
   auto tracker = assignBehavior<DragTracker>(mouse_entity);
 
   // When drag ends, run our lambda to create a new dot.
-  tracker->setMouseUpCallback([this, mouse_entity] (const vec2 &position, const vec2 &previous) mutable {
-    auto dir = position - previous;
-
-    createDot(position, dir, 49.0f);
-    mouse_entity.destroy();
+  tracker->setMouseUpCallback([this, mouse_entity] (const vec2 &position, const vec2 &delta) mutable {
+    auto dot = createDot(position, delta, 49.0f);
+#if defined(__cpp_impl_coroutine)
+    if (dot.valid()) {
+      assignBehavior<ThrowFlash>(dot);
+    }
+#else
+    (void)dot;
+#endif
+    // We're inside the BehaviorSystem's update, so destroy the tracker once it's done.
+    commands.destroy(mouse_entity);
   });
 }
 
@@ -152,6 +161,9 @@ void EntityCreationApp::update()
   if (! do_clear) {
     fadeWithAge(entities);
   }
+
+  // Apply the changes recorded during the update now that nothing is iterating.
+  commands.flush(entities);
 }
 
 void EntityCreationApp::draw()
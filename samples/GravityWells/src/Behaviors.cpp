@@ -25,7 +25,7 @@ void MouseFollow::mouseMove(const app::MouseEvent &event)
 
 void MouseFollow::update(double dt)
 {
-  auto delta = _target - _body->position;
+  auto delta = _target - _body->position();
   if (glm::length2(delta) < 1.0f && glm::length2(_body->velocity()) < 1.0f)
   {
     _body->place(_target);
@@ -29,6 +29,9 @@ class MouseFollow : public BehaviorBase
 public:
   MouseFollow(entityx::Entity entity, float strength = 1.0f);
 
+  /// Only touches our own VerletBody, so we can be updated in parallel.
+  static constexpr bool EntityLocal = true;
+
   void mouseMove(const ci::app::MouseEvent &event) final override;
 
   void update(double dt) final override;
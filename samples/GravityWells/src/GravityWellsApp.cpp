@@ -44,6 +44,8 @@ private:
   entityx::EventManager   events;
   entityx::EntityManager entities;
   entityx::SystemManager systems;
+  /// Structural changes made while iterating, applied at the end of update.
+  soso::CommandBuffer     commands;
 
   ci::Timer               frame_timer;
   const pair<vec3, vec3> world_bounds = std::make_pair(vec3(0, 0, -640), vec3(640, 480, 640));
@@ -84,7 +86,7 @@ void GravityWellsApp::createGravityWells()
 {
   auto mouse_follower = createGravityWell(vec3(getWindowCenter(), 0), 100.0f);
   assignBehavior<MouseFollow>(mouse_follower, 2.4f);
-  mouse_follower.component<VerletBody>()->drag = 0.24f;
+  mouse_follower.component<VerletBody>()->setDrag(0.24f);
 
   createGravityWell(vec3(100.0f, 100.0f, 50.0f), 150.0f);
   createGravityWell(vec3(400.0f, 300.0f, -50.0f), 100.0f);
@@ -108,7 +110,7 @@ void GravityWellsApp::mouseDown(MouseEvent event)
 {
   auto e = createFloater(vec3(event.getPos(), 0.0f));
   // Get the existing VerletBody component and modify it.
-  e.component<VerletBody>()->drag = randFloat(0.04f, 0.08f);
+  e.component<VerletBody>()->setDrag(randFloat(0.04f, 0.08f));
   // Assign a WanderingForce component, since the entity didn't have one already.
   e.assign<WanderingForce>(vec3(20.0f, 20.0f, 1.0f));
 }
@@ -127,7 +129,10 @@ void GravityWellsApp::update()
   applyLinearForce(entities);
   applyWanderingForce(entities);
   systems.update<VerletPhysicsSystem>(dt);
-  enforceBoundaries(entities);
+  enforceBoundaries(entities, commands);
+
+  // Apply the changes our systems recorded now that nothing is iterating.
+  commands.flush(entities);
 }
 
 void GravityWellsApp::draw()
@@ -141,12 +146,12 @@ void GravityWellsApp::draw()
   {
     auto attractor = e.component<PhysicsAttractor>();
     auto size = attractor ? 8.0f : 24.0f;
-    gl::drawSphere(body->position, size);
+    gl::drawSphere(body->position(), size);
 
     if (attractor)
     {
       gl::ScopedModelMatrix mat;
-      gl::translate(body->position);
+      gl::translate(body->position());
       gl::drawStrokedCircle(vec2(0), attractor->distance_falloff, 16);
     }
   }
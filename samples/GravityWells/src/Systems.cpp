@@ -38,7 +38,7 @@ void soso::applyPhysicsAttraction(EntityManager &entities)
 
     for (auto __unused e : entities.entities_with_components(attractor, attractor_body))
     {
-      auto delta = attractor_body->position - body->position;
+      auto delta = attractor_body->position() - body->position();
       auto len = glm::length( delta );
       auto t = glm::clamp( len / attractor->distance_falloff, 0.0f, 1.0f );
       t = 1.0f - (t * t);
@@ -73,13 +73,13 @@ void soso::applyWanderingForce(entityx::EntityManager &entities)
   }
 }
 
-void soso::enforceBoundaries(entityx::EntityManager &entities)
+void soso::enforceBoundaries(entityx::EntityManager &entities, CommandBuffer &commands)
 {
   entityx::ComponentHandle<VerletBody> vc;
   entityx::ComponentHandle<Bounded> bc;
   for (auto e : entities.entities_with_components(vc, bc)) {
-    if (! bc->contains(vc->position)) {
-      e.destroy();
+    if (! bc->contains(vc->position())) {
+      commands.destroy(e);
     }
   }
 }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "entityx/System.h"
+#include "CommandBuffer.h"
 
 ///
 /// @file Custom systems for the GravityWells sample application.
@@ -30,6 +31,7 @@ void applyLinearForce(entityx::EntityManager &entities);
 void applyWanderingForce(entityx::EntityManager &entities);
 
 /// Destroy any entities that have wandered outside of their own boundaries.
-void enforceBoundaries(entityx::EntityManager &entities);
+/// Destruction is recorded in commands and happens when they are flushed.
+void enforceBoundaries(entityx::EntityManager &entities, CommandBuffer &commands);
 
 } // namespace soso
@@ -30,9 +30,12 @@ public:
     _transform = entity.has_component<Transform>() ? entity.component<Transform>() : entity.assign<Transform>(entity);
   }
 
+  /// Only touches our own Transform, so we can be updated in parallel.
+  static constexpr bool EntityLocal = true;
+
   void update(double dt) override {
-    _transform->orientation *= glm::angleAxis<float>(_radians_per_second * dt, _axis);
-    glm::normalize(_transform->orientation);
+    auto orientation = _transform->orientation() * glm::angleAxis<float>(_radians_per_second * dt, _axis);
+    _transform->setOrientation(glm::normalize(orientation));
   }
 
 private:
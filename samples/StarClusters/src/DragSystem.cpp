@@ -8,48 +8,73 @@
 #include "DragSystem.h"
 #include "Draggable.h"
 #include "Transform.h"
+#include "Circle.h"
 
 using namespace soso;
 using namespace entityx;
 using namespace cinder;
 using namespace cinder::app;
 
-void DragSystem::configure(entityx::EventManager &events)
+void DragSystem::update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt)
 {
-  auto window = app::getWindow();
-  auto mouse_down = [this] (MouseEvent &event) { mouseDown( event ); };
-  auto mouse_drag = [this] (MouseEvent &event) { mouseDrag( event ); };
-
-  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseDown().connect( mouse_down ) ) );
-  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseDrag().connect( mouse_drag ) ) );
+  // Positions may have changed since the last pick.
+  _pick_index_stale = true;
+  _input.dispatch([this] (const InputQueue::MouseInput &input) {
+    switch (input.type)
+    {
+      case InputQueue::Type::MouseDown:
+        mouseDown(input.event);
+      break;
+      case InputQueue::Type::MouseDrag:
+        mouseDrag(input.event);
+      break;
+      default:
+      break;
+    }
+  });
 }
 
-void DragSystem::mouseDown(ci::app::MouseEvent &event)
+void DragSystem::mouseDown(const ci::app::MouseEvent &event)
 {
-  ComponentHandle<Draggable> drag;
-  ComponentHandle<Transform> transform;
-  _dragging_entity.invalidate();
+  if (_pick_index_stale) {
+    buildPickIndex();
+  }
 
-  auto p1 = vec3(event.getPos(), 0.0f);
-  auto r = _grab_radius;
-  for (auto e : _entities.entities_with_components(transform, drag)) {
-    auto d = distance(p1, vec3(vec2(transform->worldPoint()), 0.0f));
-    if (d < r) {
-      _drag_start = p1;
-      _entity_start = transform->position;
-      _dragging_entity = e;
-      r = d;
-    }
+  _dragging_entity.invalidate();
+  auto *target = _pick_index.pick(vec2(event.getPos()));
+  if (target && target->entity.valid()) {
+    _drag_start = vec3(event.getPos(), 0.0f);
+    _entity_start = target->entity.component<Transform>()->position();
+    _dragging_entity = target->entity;
   }
 }
 
-void DragSystem::mouseDrag(ci::app::MouseEvent &event)
+void DragSystem::mouseDrag(const ci::app::MouseEvent &event)
 {
   if (_dragging_entity) {
     ComponentHandle<Draggable> drag;
     ComponentHandle<Transform> xf;
     _dragging_entity.unpack(drag, xf);
 
-    xf->position = _entity_start + (vec3(event.getPos(), 0.0f) - _drag_start) * vec3(drag->_axes, 1.0f);
+    xf->setPosition(_entity_start + (vec3(event.getPos(), 0.0f) - _drag_start) * vec3(drag->_axes, 1.0f));
+  }
+}
+
+void DragSystem::buildPickIndex()
+{
+  ComponentHandle<Draggable> drag;
+  ComponentHandle<Transform> transform;
+
+  _pick_index.clear();
+  for (auto e : _entities.entities_with_components(transform, drag)) {
+    auto radius = _grab_radius;
+    auto circle = e.component<Circle>();
+    if (circle) {
+      // Scale the circle the same way it is drawn.
+      radius = circle->radius * length(transform->worldAffine().transformVector(vec3(1.0f, 0.0f, 0.0f)));
+    }
+    _pick_index.insert(e, vec2(transform->worldPoint()), radius, transform->depth());
   }
+  _pick_index.build();
+  _pick_index_stale = false;
 }
@@ -8,36 +8,45 @@
 #pragma once
 
 #include "entityx/System.h"
+#include "InputQueue.h"
+#include "PickIndex.h"
 
 namespace soso {
 
 ///
 /// A simple dragging system for moving entities relative to the mouse.
 /// Does not handle complex hierachical transformations; you can only effectively drag roots.
+/// Mouse events are queued and handled once per update, so a burst of drags costs a single move.
+/// Presses are resolved against a PickIndex of draggable entities, rebuilt at most once per update.
+/// An entity's Circle gives its pick radius; entities without one use the grab radius.
 ///
 class DragSystem : public entityx::System<DragSystem>
 {
 public:
   explicit DragSystem(entityx::EntityManager &entities)
-  : _entities(entities)
+  : _input(ci::app::getWindow()),
+    _entities(entities)
   {}
 
-  void configure(entityx::EventManager &events) override;
-  void update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) override {}
-  void mouseDown(ci::app::MouseEvent &event);
-  void mouseDrag(ci::app::MouseEvent &event);
+  void update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) override;
+  void mouseDown(const ci::app::MouseEvent &event);
+  void mouseDrag(const ci::app::MouseEvent &event);
 
   /// Set the radius for grabbing things (if we don't have a component specifying the bounds of the shape).
   void setGrabRadius(float radius) { _grab_radius = radius; }
 
 private:
-  using ScopedConnectionRef = std::shared_ptr<ci::signals::ScopedConnection>;
-  std::vector<ScopedConnectionRef> _signal_connections;
+  InputQueue                       _input;
   entityx::EntityManager          &_entities;
+  PickIndex                        _pick_index;
+  bool                             _pick_index_stale = true;
   entityx::Entity                  _dragging_entity;
   ci::vec3                        _entity_start;
   ci::vec3                        _drag_start;
   float                            _grab_radius = 50.0f;
+
+  /// Collects the screen position and radius of every draggable entity from the latest world transforms.
+  void buildPickIndex();
 };
 
 } // namespace soso
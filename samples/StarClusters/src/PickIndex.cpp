@@ -0,0 +1,90 @@
+//
+//  PickIndex.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "PickIndex.h"
+#include <algorithm>
+
+using namespace soso;
+using namespace cinder;
+
+void PickIndex::clear()
+{
+  _targets.clear();
+  _cells.clear();
+}
+
+void PickIndex::insert(entityx::Entity entity, const ci::vec2 &center, float radius, size_t depth)
+{
+  if (radius > 0.0f) {
+    _targets.push_back(Target{ entity, center, radius, depth });
+  }
+}
+
+void PickIndex::build()
+{
+  _cells.clear();
+  if (_targets.empty()) {
+    return;
+  }
+
+  // Size cells to the average target so most targets overlap at most four cells.
+  auto total_radius = 0.0f;
+  for (auto &target : _targets) {
+    total_radius += target.radius;
+  }
+  _cell_size = std::max(2.0f * total_radius / _targets.size(), 1.0f);
+
+  for (uint32_t i = 0; i < _targets.size(); i += 1) {
+    auto &target = _targets[i];
+    auto extent = vec2(target.radius);
+    auto min = cellCoordinates(target.center - extent);
+    auto max = cellCoordinates(target.center + extent);
+    for (auto y = min.y; y <= max.y; y += 1) {
+      for (auto x = min.x; x <= max.x; x += 1) {
+        _cells.push_back(CellEntry{ cellKey(ivec2(x, y)), i });
+      }
+    }
+  }
+
+  std::sort(_cells.begin(), _cells.end(), [] (const CellEntry &a, const CellEntry &b) {
+    return a.cell < b.cell;
+  });
+}
+
+const PickIndex::Target* PickIndex::pick(const ci::vec2 &point) const
+{
+  auto key = cellKey(cellCoordinates(point));
+  auto begin = std::lower_bound(_cells.begin(), _cells.end(), key, [] (const CellEntry &entry, uint64_t key) {
+    return entry.cell < key;
+  });
+
+  const Target *best = nullptr;
+  auto best_distance = 0.0f;
+  for (auto it = begin; it != _cells.end() && it->cell == key; ++it) {
+    auto &target = _targets[it->target];
+    auto d = distance(point, target.center) / target.radius;
+    if (d >= 1.0f) {
+      continue;
+    }
+    if (! best || target.depth > best->depth || (target.depth == best->depth && d < best_distance)) {
+      best = &target;
+      best_distance = d;
+    }
+  }
+
+  return best;
+}
+
+ci::ivec2 PickIndex::cellCoordinates(const ci::vec2 &point) const
+{
+  return ivec2(std::floor(point.x / _cell_size), std::floor(point.y / _cell_size));
+}
+
+uint64_t PickIndex::cellKey(const ci::ivec2 &coordinates)
+{
+  return (uint64_t(uint32_t(coordinates.y)) << 32) | uint32_t(coordinates.x);
+}
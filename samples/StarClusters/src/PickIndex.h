@@ -0,0 +1,63 @@
+//
+//  PickIndex.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "entityx/Entity.h"
+#include <vector>
+
+namespace soso {
+
+///
+/// A screen-space grid of circular pick targets for finding what lies under a pointer.
+/// Targets are bucketed into square cells, and the cells are kept sorted by key,
+/// so a pick is a binary search for one cell plus a test of the few targets overlapping it.
+///
+/// Rebuild the index from fresh world positions before picking; it holds no reference to the transforms.
+///
+class PickIndex
+{
+public:
+  struct Target
+  {
+    entityx::Entity entity;
+    ci::vec2        center;
+    float           radius;
+    /// Depth in the transform hierarchy. Deeper targets are drawn over their ancestors, so they win ties.
+    size_t          depth;
+  };
+
+  /// Removes all targets.
+  void clear();
+  /// Adds a target; targets without a positive radius are ignored. Call build() after adding targets and before picking.
+  void insert( entityx::Entity entity, const ci::vec2 &center, float radius, size_t depth );
+  /// Sizes the grid to the targets and buckets them into cells.
+  void build();
+
+  /// Returns the target containing point, or nullptr.
+  /// When targets overlap, the deepest wins, then the one whose center is closest relative to its radius.
+  const Target* pick( const ci::vec2 &point ) const;
+
+  size_t size() const { return _targets.size(); }
+
+private:
+  struct CellEntry
+  {
+    uint64_t  cell;
+    uint32_t  target;
+  };
+
+  std::vector<Target>     _targets;
+  /// One entry per (cell, target) overlap, sorted by cell.
+  std::vector<CellEntry>  _cells;
+  float                   _cell_size = 1.0f;
+
+  ci::ivec2 cellCoordinates( const ci::vec2 &point ) const;
+  static uint64_t cellKey( const ci::ivec2 &coordinates );
+};
+
+} // namespace soso
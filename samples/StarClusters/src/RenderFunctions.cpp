@@ -36,8 +36,9 @@ void soso::renderCircles(entityx::EntityManager &entities)
   entityx::ComponentHandle<Circle>    circle;
 
   auto billboard_xf = [] (Transform::Handle transform) {
-    auto q = inverse(normalize(quat_cast(transform->worldTransform())));
-    return transform->worldTransform() * glm::mat4_cast(q);
+    auto world = transform->worldTransform();
+    auto q = inverse(normalize(quat_cast(world)));
+    return world * glm::mat4_cast(q);
   };
 
   gl::ScopedColor color(Color(1.0f, 1.0f, 1.0f));
@@ -73,8 +74,9 @@ void soso::renderCirclesDepthSorted(entityx::EntityManager &entities)
   entityx::ComponentHandle<Circle>    circle;
 
   for (auto __unused e : entities.entities_with_components(transform, circle)) {
-    auto pos = vec3(transform->worldTransform() * vec4(0, 0, 0, 1));
-    auto scale = length(vec3(transform->worldTransform() * vec4(1, 0, 0, 0)));
+    auto &world = transform->worldAffine();
+    auto pos = world.translation();
+    auto scale = length(world.transformVector(vec3(1, 0, 0)));
     circles.insert(insertion_point(pos.z), RenderInfo{pos, scale, circle->radius, circle->color});
   }
 
@@ -94,32 +96,18 @@ void soso::renderCirclesHierarchically(entityx::EntityManager &entities)
 {
   entityx::ComponentHandle<Transform> transform;
   entityx::ComponentHandle<Circle>    circle;
-  auto xf = mat4(1);
 
-  const auto billboard_xf = [] (const Transform &transform) {
-    auto q = inverse(normalize(quat_cast(transform.localTransform())));
-    return transform.localTransform() * glm::mat4_cast(q);
-  };
-
-  using function = std::function<void (Transform::Handle)>;
-  function draw_recursively = [&billboard_xf, &draw_recursively] (Transform::Handle transform) {
+  const auto draw = [] (const Transform &transform) {
+    auto circle = transform.entity().component<Circle>();
+    if (circle)
+    {
+      // billboard the circles (mostly works)
+      auto world = transform.worldTransform();
       gl::ScopedModelMatrix mat;
-      gl::multModelMatrix(transform->localTransform());
-
-      auto circle = transform->entity().component<Circle>();
-      if (circle)
-      {
-        // billboard the circles (mostly works)
-        gl::ScopedModelMatrix mat;
-        gl::multModelMatrix(glm::mat4_cast(inverse(normalize(quat_cast(transform->worldTransform())))));
-        gl::color(circle->color);
-        gl::drawSolidCircle(vec2(0), circle->radius);
-      }
-
-      for (auto &child: transform->children())
-      {
-        draw_recursively(child);
-      }
+      gl::multModelMatrix(world * glm::mat4_cast(inverse(normalize(quat_cast(world)))));
+      gl::color(circle->color);
+      gl::drawSolidCircle(vec2(0), circle->radius);
+    }
   };
 
   gl::ScopedColor        color(Color::white());
@@ -127,7 +115,10 @@ void soso::renderCirclesHierarchically(entityx::EntityManager &entities)
   for (auto __unused e : entities.entities_with_components(transform, circle)) {
     if (transform->isRoot())
     {
-      draw_recursively(transform);
+      draw(*transform.get());
+      transform->descend([&draw] (const Transform &parent, Transform &child) {
+        draw(child);
+      });
     }
   }
 }
@@ -167,18 +158,21 @@ void soso::renderCirclesByLayer(entityx::EntityManager &entities)
   };
 
   // Billboards a transform matrix.
-  auto billboard_xf = [] (Transform::Handle transform) {
-    auto q = inverse(normalize(quat_cast(transform->worldTransform())));
-    return transform->worldTransform() * glm::mat4_cast(q);
+  auto billboard_xf = [] (const Transform &transform) {
+    auto world = transform.worldTransform();
+    auto q = inverse(normalize(quat_cast(world)));
+    return world * glm::mat4_cast(q);
   };
 
-  // Recursive function to properly capture render layer changes.
-  using function = std::function<void (Transform::Handle, int)>;
-  function gather_recursively = [&gather_recursively, &get_layer, &billboard_xf] (Transform::Handle transform, int layer) {
+  // Layers of the current node's ancestors, so render layer changes carry down the hierarchy.
+  std::vector<std::pair<const Transform*, int>> ancestor_layers;
+
+  // Gathers a single node, given the layer it inherits from its parent. Returns the node's own layer.
+  auto gather = [&get_layer, &billboard_xf] (const Transform &transform, int layer) {
 
     auto rlc = entityx::ComponentHandle<soso::RenderLayer>();
     auto circle = entityx::ComponentHandle<Circle>();
-    auto e = transform->entity();
+    auto e = transform.entity();
     e.unpack(rlc, circle);
 
     if (rlc)
@@ -198,10 +192,7 @@ void soso::renderCirclesByLayer(entityx::EntityManager &entities)
       get_layer(layer).push_back({ billboard_xf(transform), circle->color, circle->radius });
     }
 
-    for (auto &c : transform->children())
-    {
-      gather_recursively(c, layer);
-    }
+    return layer;
   };
 
   entityx::ComponentHandle<Transform> transform;
@@ -210,7 +201,15 @@ void soso::renderCirclesByLayer(entityx::EntityManager &entities)
     // gather trees for rendering
     if (transform->isRoot())
     {
-      gather_recursively(transform, 0);
+      ancestor_layers.clear();
+      ancestor_layers.emplace_back(transform.get(), gather(*transform.get(), 0));
+      // Visits are depth-first, so the parent is always somewhere on the ancestor stack.
+      transform->descend([&ancestor_layers, &gather] (const Transform &parent, Transform &child) {
+        while (ancestor_layers.back().first != &parent) {
+          ancestor_layers.pop_back();
+        }
+        ancestor_layers.emplace_back(&child, gather(child, ancestor_layers.back().second));
+      });
     }
   }
 
@@ -11,6 +11,8 @@
 #include "Components.h"
 #include "Systems.h"
 #include "RenderLayer.h"
+#include "WorkerPool.h"
+#include "CommandBuffer.h"
 
 #include "RenderFunctions.h"
 
@@ -75,6 +77,7 @@ entityx::Entity createSolarSystem(entityx::EntityManager &entities, const ci::ve
 ///
 /// Drag suns to reposition them.
 /// Press 'c' to create a new solar system.
+/// Press 'p' to toggle between serial and parallel transform and behavior updates.
 /// Number keys cycle through render functions.
 ///
 class StarClustersApp : public App {
@@ -92,6 +95,8 @@ private:
   entityx::EventManager    _events;
   entityx::EntityManager  _entities;
   entityx::SystemManager  _systems;
+  /// Structural changes made while iterating, applied at the end of update.
+  soso::CommandBuffer     _commands;
 
   ci::Timer                _frame_timer;
   /// We specify the render function as a free function.
@@ -115,6 +120,11 @@ void StarClustersApp::setup()
   _systems.add<TransformSystem>();
   _systems.configure();
 
+  // Let our parallel systems share worker threads.
+  auto workers = make_shared<WorkerPool>();
+  _systems.system<BehaviorSystem>()->setWorkerPool(workers);
+  _systems.system<TransformSystem>()->setWorkerPool(workers);
+
   // Create an initial solar system on screen.
   createSolarSystem(_entities, vec3(getWindowCenter(), 0.0f));
 }
@@ -122,6 +132,7 @@ void StarClustersApp::setup()
 void StarClustersApp::keyDown(KeyEvent event)
 {
   // 'c' creates a new solar system
+  // 'p' toggles parallel transform and behavior updates
   // Numbers change rendering modes.
 
   switch (event.getCode())
@@ -135,6 +146,15 @@ void StarClustersApp::keyDown(KeyEvent event)
       createSolarSystem(_entities, vec3(center + offset, 0.0f));
     }
     break;
+    case KeyEvent::KEY_p:
+    {
+      auto transforms = _systems.system<TransformSystem>();
+      auto behaviors = _systems.system<BehaviorSystem>();
+      transforms->setParallel(! transforms->isParallel());
+      behaviors->setParallel(transforms->isParallel());
+      CI_LOG_I("Updating transforms and behaviors " << (transforms->isParallel() ? "in parallel" : "serially"));
+    }
+    break;
     case KeyEvent::KEY_1:
       CI_LOG_I("Rendering circles with depth testing");
       _render_function = &renderCircles;
@@ -166,10 +186,11 @@ void StarClustersApp::shrinkSolarSystems()
   entityx::ComponentHandle<Sun> sun;
   for (auto e : _entities.entities_with_components(xf, sun))
   {
-    xf->scale *= 0.8f;
-    if (xf->scale.x < 0.33f)
+    xf->setScale(xf->scale() * 0.8f);
+    if (xf->scale().x < 0.33f)
     {
-      e.destroy();
+      // Destroying a sun's Transform destroys its planets too, so the whole system goes at the next flush.
+      _commands.destroy(e);
     }
   }
 }
@@ -182,7 +203,11 @@ void StarClustersApp::update()
     dt = 1.0 / 60.0;
   }
   _systems.update<BehaviorSystem>(dt);
+  _systems.update<DragSystem>(dt);
   _systems.update<TransformSystem>(dt);
+
+  // Apply the changes recorded since the last update now that nothing is iterating.
+  _commands.flush(_entities);
 }
 
 void StarClustersApp::draw()
@@ -0,0 +1,97 @@
+//
+//  AffineTransform.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+namespace soso {
+
+///
+/// An affine transformation stored as the top three rows of a 4x4 matrix.
+/// The bottom row is always (0, 0, 0, 1), so it is implied rather than stored.
+/// Each row holds the rotation/scale terms in xyz and the translation in w.
+///
+struct AffineTransform
+{
+  /// Constructs an identity transform.
+  AffineTransform() = default;
+  /// Constructs from a 4x4 matrix, dropping its bottom row.
+  explicit AffineTransform(const ci::mat4 &m)
+  : rows{ ci::vec4(m[0][0], m[1][0], m[2][0], m[3][0]), ci::vec4(m[0][1], m[1][1], m[2][1], m[3][1]), ci::vec4(m[0][2], m[1][2], m[2][2], m[3][2]) }
+  {}
+
+  ci::vec4 rows[3] = { ci::vec4(1, 0, 0, 0), ci::vec4(0, 1, 0, 0), ci::vec4(0, 0, 1, 0) };
+
+  /// Expands to a full 4x4 matrix. Use at the render boundary.
+  ci::mat4 toMat4() const {
+    return ci::mat4(ci::vec4(rows[0].x, rows[1].x, rows[2].x, 0),
+                    ci::vec4(rows[0].y, rows[1].y, rows[2].y, 0),
+                    ci::vec4(rows[0].z, rows[1].z, rows[2].z, 0),
+                    ci::vec4(rows[0].w, rows[1].w, rows[2].w, 1));
+  }
+
+  ci::vec3 translation() const { return ci::vec3(rows[0].w, rows[1].w, rows[2].w); }
+
+  /// Transforms a point, applying translation.
+  ci::vec3 transformPoint(const ci::vec3 &p) const { return transformVector(p) + translation(); }
+  /// Transforms a direction, ignoring translation.
+  ci::vec3 transformVector(const ci::vec3 &v) const {
+    return ci::vec3(rows[0].x * v.x + rows[0].y * v.y + rows[0].z * v.z,
+                    rows[1].x * v.x + rows[1].y * v.y + rows[1].z * v.z,
+                    rows[2].x * v.x + rows[2].y * v.y + rows[2].z * v.z);
+  }
+};
+
+/// Blends between two affine transforms for interpolating between simulation steps.
+/// Translation and scale are blended linearly and rotation spherically. Shear (e.g. from non-uniform scale under rotation) is not preserved.
+inline AffineTransform interpolate(const AffineTransform &from, const AffineTransform &to, float t)
+{
+  struct Parts {
+    ci::vec3  translation;
+    ci::vec3  scale;
+    ci::quat  rotation;
+  };
+
+  // Splits a transform into translation, scale and rotation. Returns false if the transform has zero scale.
+  auto decompose = [] (const AffineTransform &m, Parts &parts) {
+    auto linear = ci::mat3(ci::vec3(m.rows[0].x, m.rows[1].x, m.rows[2].x),
+                           ci::vec3(m.rows[0].y, m.rows[1].y, m.rows[2].y),
+                           ci::vec3(m.rows[0].z, m.rows[1].z, m.rows[2].z));
+    parts.translation = m.translation();
+    parts.scale = ci::vec3(glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]));
+    if (glm::determinant(linear) < 0.0f) {
+      parts.scale.x = - parts.scale.x;
+    }
+    for (int c = 0; c < 3; c += 1) {
+      if (parts.scale[c] == 0.0f) {
+        return false;
+      }
+      linear[c] /= parts.scale[c];
+    }
+    parts.rotation = glm::quat_cast(linear);
+    return true;
+  };
+
+  AffineTransform result;
+  Parts a, b;
+  if (! decompose(from, a) || ! decompose(to, b)) {
+    // Degenerate; blend the rows directly.
+    for (int r = 0; r < 3; r += 1) {
+      result.rows[r] = glm::mix(from.rows[r], to.rows[r], t);
+    }
+    return result;
+  }
+
+  auto rotation = glm::mat3_cast(glm::slerp(a.rotation, b.rotation, t));
+  auto scale = glm::mix(a.scale, b.scale, t);
+  auto translation = glm::mix(a.translation, b.translation, t);
+  for (int r = 0; r < 3; r += 1) {
+    result.rows[r] = ci::vec4(rotation[0][r] * scale.x, rotation[1][r] * scale.y, rotation[2][r] * scale.z, translation[r]);
+  }
+  return result;
+}
+
+} // namespace soso
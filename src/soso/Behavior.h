@@ -8,23 +8,73 @@
 #pragma once
 
 #include "entityx/Entity.h"
+#include "BehaviorStore.h"
+#include "SharedBehavior.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 
 namespace soso {
 
 class BehaviorBase;
-using BehaviorRef = std::shared_ptr<BehaviorBase>;
 
 ///
 /// Stores list of behaviors applied to entity.
+/// The behaviors themselves live in the BehaviorSystem's store, grouped by type.
 ///
 struct BehaviorComponent
 {
-  std::vector<BehaviorRef> behaviors;
+  BehaviorComponent() = default;
+  /// Copies start without behaviors, since each behavior belongs to a single entity.
+  /// This lets EntityManager::create_from_copy copy entities that have behaviors; assign new ones to the copy.
+  BehaviorComponent( const BehaviorComponent &other )
+  : store( other.store )
+  {}
+  /// Not assignable, since assigning would leave behaviors attached to the wrong entity.
+  BehaviorComponent& operator=( const BehaviorComponent & ) = delete;
+
+  ~BehaviorComponent()
+  {
+    for( auto *behavior : behaviors ) {
+      store->destroy( behavior );
+    }
+    for( auto &behavior : shared_behaviors ) {
+      behavior->remove( entity );
+    }
+  }
+
+  /// Set by the BehaviorSystem when the component is assigned.
+  /// Shared so behaviors can outlive the system during teardown.
+  std::shared_ptr<BehaviorStore>  store;
+  /// The entity we belong to. Also set by the BehaviorSystem.
+  entityx::Entity                 entity;
+  /// Sorted by BehaviorStore::typeIndex, so the behaviors of each type are a contiguous range.
+  /// Behaviors of the same type stay in the order they were assigned.
+  /// Change it through insert and take, which keep the index of each type's range up to date.
+  std::vector<BehaviorBase*>      behaviors;
+  std::vector<SharedBehaviorRef>  shared_behaviors;
+
+  using Range = std::pair<std::vector<BehaviorBase*>::iterator, std::vector<BehaviorBase*>::iterator>;
+  /// Returns the range of behaviors of exactly the given type, in constant time.
+  Range behaviorsOfType( size_t type );
+  /// Adds a behavior after the others of its type.
+  void insert( BehaviorBase *behavior );
+  /// Takes the behaviors in \a range, which must lie within behaviorsOfType( type ), out of the list and returns them.
+  std::vector<BehaviorBase*> take( size_t type, Range range );
+  /// Takes every behavior for which \a pred returns true out of the list and returns them.
+  template <typename Pred>
+  std::vector<BehaviorBase*> takeIf( Pred pred );
+
+private:
+  /// Where each type's range ends in behaviors, indexed by BehaviorStore::typeIndex.
+  /// Grows to the largest type this entity has had; larger types have no behaviors.
+  std::vector<uint32_t>           _type_ends;
 };
 
 ///
 /// Base class for custom entity behaviors.
 /// Receives event callbacks and an update function.
+/// Only override the handlers you need; BehaviorSystem skips behavior types that don't override a handler.
 ///
 class BehaviorBase
 {
@@ -36,6 +86,12 @@ public:
 
   virtual ~BehaviorBase() = default;
 
+  /// Behavior types that only read and write their own entity's components (and their own members) in update
+  /// can shadow this with `static constexpr bool EntityLocal = true;` to let the BehaviorSystem update them in parallel.
+  /// An entity-local update must not create, destroy, assign or remove anything, or touch other entities,
+  /// and an entity should have at most one behavior of each entity-local type.
+  static constexpr bool EntityLocal = false;
+
   virtual void update( entityx::TimeDelta dt ) {}
 
   virtual void mouseMove( const ci::app::MouseEvent &event ) {}
@@ -49,9 +105,55 @@ public:
   /// Remove this behavior from its entity.
   void remove();
   bool valid() const { return entity().valid(); }
+  /// False once this behavior has been removed, even if the store hasn't destroyed it yet.
+  bool active() const { return _pool && _pool->active( this ); }
+
+  /// Inside mouse handlers, the movement covered by the event being handled.
+  /// Moves and drags are coalesced once per update, so this includes every position between the previous event and this one.
+  ci::vec2 mouseDelta() const;
+
+  /// This behavior's concrete type, as BehaviorStore::typeIndex.
+  size_t behaviorType() const { return _type; }
+
+  /// Run update every frame. This is the default.
+  void updateEveryFrame() { setSchedule( Schedule::EveryFrame, 0 ); }
+  /// Run update once every n frames, passing it the time elapsed since its last update.
+  void updateEveryNthFrame( uint32_t n ) { setSchedule( n > 1 ? Schedule::Frames : Schedule::EveryFrame, n ); }
+  /// Run update roughly once per interval, passing it the time elapsed since its last update.
+  /// Useful for ambient behaviors that only need to run a few times per second.
+  void updateEvery( entityx::TimeDelta seconds ) { setSchedule( seconds > 0 ? Schedule::Seconds : Schedule::EveryFrame, seconds ); }
 
 private:
-  entityx::Entity  _entity;
+  enum class Schedule : uint8_t
+  {
+    EveryFrame,
+    Frames,
+    Seconds
+  };
+
+  entityx::Entity   _entity;
+  /// Where this behavior is stored. Set by the pool when the behavior is created.
+  BehaviorPoolBase  *_pool = nullptr;
+  size_t            _slot = 0;
+  size_t            _type = 0;
+
+  Schedule          _schedule = Schedule::EveryFrame;
+  /// Frames or seconds between updates.
+  double            _interval = 0;
+  /// Frames or seconds until the next update.
+  double            _countdown = 0;
+  /// Time since the last update.
+  entityx::TimeDelta _elapsed = 0;
+
+  void setSchedule( Schedule schedule, double interval );
+  /// Spreads behaviors with the same interval across it, by slot, so they don't all update on the same frame.
+  void staggerSchedule();
+  /// Advances the schedule by a frame. Returns true and sets elapsed if update should run.
+  bool tick( entityx::TimeDelta dt, entityx::TimeDelta *elapsed );
+
+  template <typename B>
+  friend class BehaviorPool;
+  friend class BehaviorStore;
 };
 
 class BehaviorLambda : public BehaviorBase
@@ -73,55 +175,94 @@ private:
 };
 
 /// Construct and assign a behavior of type B to an entity.
+/// The returned pointer stays valid until the behavior is removed or its entity is destroyed.
+/// Requires a configured BehaviorSystem, which owns the behavior's storage.
 template <typename B, typename ... Params>
-std::shared_ptr<B> assignBehavior( entityx::Entity entity, Params&& ... params )
+B* assignBehavior( entityx::Entity entity, Params&& ... params )
 {
-  auto behavior = std::make_shared<B>( entity, std::forward<Params>( params ) ... );
   auto component = entity.has_component<BehaviorComponent>() ? entity.component<BehaviorComponent>() : entity.assign<BehaviorComponent>();
-  component->behaviors.push_back( behavior );
+  assert( component->store && "Add and configure a BehaviorSystem before assigning behaviors." );
+  auto behavior = component->store->create<B>( entity, std::forward<Params>( params ) ... );
+  component->insert( behavior );
   return behavior;
 }
 
-inline std::shared_ptr<BehaviorLambda> assignBehavior( entityx::Entity entity, const BehaviorLambda::Lambda &lambda )
+inline BehaviorLambda* assignBehavior( entityx::Entity entity, const BehaviorLambda::Lambda &lambda )
 {
-  auto behavior = std::make_shared<BehaviorLambda>( entity, lambda );
-  auto component = entity.has_component<BehaviorComponent>() ? entity.component<BehaviorComponent>() : entity.assign<BehaviorComponent>();
-  component->behaviors.push_back( behavior );
-  return behavior;
+  return assignBehavior<BehaviorLambda>( entity, lambda );
 }
 
-/*
-// For now, we require assignBehavior to initialize the behavior with the entity.
-// This prevents unexpected behavior if two entities have the same behavior attached to them.
-// If we move to passing the entity into each virtual method, we could share behaviors across entities.
-inline void assignBehavior( entityx::Entity entity, const BehaviorRef &behavior )
+/// Apply a shared behavior to an entity. One behavior can be applied to any number of entities,
+/// and is updated once per frame with all of them. Applying it to the same entity twice has no effect.
+inline void assignBehavior( entityx::Entity entity, const SharedBehaviorRef &behavior )
 {
   auto component = entity.has_component<BehaviorComponent>() ? entity.component<BehaviorComponent>() : entity.assign<BehaviorComponent>();
-  component->behaviors.push_back( behavior );
+  assert( component->store && "Add and configure a BehaviorSystem before assigning behaviors." );
+  auto &b = component->shared_behaviors;
+  if( std::find( b.begin(), b.end(), behavior ) == b.end() ) {
+    b.push_back( behavior );
+    behavior->add( *component->store, entity );
+  }
+}
+
+/// Returns true if entity has a behavior of exactly type B.
+template <typename B>
+bool hasBehavior( entityx::Entity entity )
+{
+  auto component = entity.component<BehaviorComponent>();
+  if( ! component ) {
+    return false;
+  }
+  auto range = component->behaviorsOfType( BehaviorStore::typeIndex<B>() );
+  return range.first != range.second;
+}
+
+/// Returns entity's first behavior of exactly type B, or nullptr.
+template <typename B>
+B* getBehavior( entityx::Entity entity )
+{
+  auto component = entity.component<BehaviorComponent>();
+  if( ! component ) {
+    return nullptr;
+  }
+  auto range = component->behaviorsOfType( BehaviorStore::typeIndex<B>() );
+  return range.first != range.second ? static_cast<B*>( *range.first ) : nullptr;
 }
-*/
 
-/// Remove all behaviors of type B from entity.
+/// Remove all behaviors of exactly type B from entity, leaving behaviors derived from B.
+/// Looks up the entity's behaviors of type B directly, without RTTI.
 /// e.g. removeBehaviorsOfType<Seeker>( entity );
 template <typename B>
 void removeBehaviorsOfType( entityx::Entity entity )
 {
   auto component = entity.component<BehaviorComponent>();
-  if (component) {
-    auto &b = component->behaviors;
-    b.erase( std::remove_if( b.begin(), b.end(), [] (const BehaviorRef &behavior) {
-      return std::dynamic_pointer_cast<B>( behavior );
-    } ), b.end() );
+  if( component ) {
+    // Take the matches out of the list before destroying them, in case a destructor destroys the entity.
+    auto type = BehaviorStore::typeIndex<B>();
+    auto removed = component->take( type, component->behaviorsOfType( type ) );
+
+    auto store = component->store;
+    for( auto *behavior : removed ) {
+      store->destroy( behavior );
+    }
   }
 }
 
-/// Remove a specific behavior from an entity.
-inline void removeBehavior( entityx::Entity entity, const BehaviorRef &behavior )
+/// Remove all behaviors of type B, or derived from it, from entity.
+/// Checks each of the entity's behaviors with dynamic_cast, so prefer removeBehaviorsOfType when B has no subclasses.
+template <typename B>
+void removeBehaviorsDerivedFrom( entityx::Entity entity )
 {
   auto component = entity.component<BehaviorComponent>();
-  if (component) {
-    auto &b = component->behaviors;
-    b.erase( std::remove( b.begin(), b.end(), behavior ), b.end() );
+  if( component ) {
+    auto removed = component->takeIf( [] (BehaviorBase *behavior) {
+      return dynamic_cast<B*>( behavior ) != nullptr;
+    } );
+
+    auto store = component->store;
+    for( auto *behavior : removed ) {
+      store->destroy( behavior );
+    }
   }
 }
 
@@ -130,17 +271,144 @@ inline void removeBehavior( entityx::Entity entity, BehaviorBase *behavior )
 {
   auto component = entity.component<BehaviorComponent>();
   if (component) {
-    auto &b = component->behaviors;
-    b.erase( std::remove_if( b.begin(), b.end(), [behavior] (const BehaviorRef &element) {
-      return element.get() == behavior;
-    } ), b.end() );
+    auto type = behavior->behaviorType();
+    auto range = component->behaviorsOfType( type );
+    auto iter = std::find( range.first, range.second, behavior );
+    if( iter != range.second ) {
+      component->take( type, BehaviorComponent::Range( iter, iter + 1 ) );
+      component->store->destroy( behavior );
+    }
+  }
+}
+
+inline BehaviorComponent::Range BehaviorComponent::behaviorsOfType( size_t type )
+{
+  if( type >= _type_ends.size() ) {
+    return Range( behaviors.end(), behaviors.end() );
   }
+  auto begin = (type == 0) ? 0 : _type_ends[type - 1];
+  return Range( behaviors.begin() + begin, behaviors.begin() + _type_ends[type] );
+}
+
+inline void BehaviorComponent::insert( BehaviorBase *behavior )
+{
+  auto type = behavior->behaviorType();
+  if( type >= _type_ends.size() ) {
+    // Every behavior we have is of a smaller type, so the new types' ranges start empty at the end.
+    _type_ends.resize( type + 1, static_cast<uint32_t>( behaviors.size() ) );
+  }
+  behaviors.insert( behaviors.begin() + _type_ends[type], behavior );
+  for( auto i = type; i < _type_ends.size(); i += 1 ) {
+    _type_ends[i] += 1;
+  }
+}
+
+inline std::vector<BehaviorBase*> BehaviorComponent::take( size_t type, Range range )
+{
+  std::vector<BehaviorBase*> taken( range.first, range.second );
+  behaviors.erase( range.first, range.second );
+  auto count = static_cast<uint32_t>( taken.size() );
+  for( auto i = type; i < _type_ends.size(); i += 1 ) {
+    _type_ends[i] -= count;
+  }
+  return taken;
+}
+
+template <typename Pred>
+std::vector<BehaviorBase*> BehaviorComponent::takeIf( Pred pred )
+{
+  // The partition is stable, so the rest stay sorted by type.
+  auto begin = std::stable_partition( behaviors.begin(), behaviors.end(), [&pred] (BehaviorBase *behavior) {
+    return ! pred( behavior );
+  } );
+  std::vector<BehaviorBase*> taken( begin, behaviors.end() );
+  behaviors.erase( begin, behaviors.end() );
+
+  // Count what is left of each type, then sum the counts into range ends.
+  std::fill( _type_ends.begin(), _type_ends.end(), 0 );
+  for( auto *behavior : behaviors ) {
+    _type_ends[behavior->behaviorType()] += 1;
+  }
+  std::partial_sum( _type_ends.begin(), _type_ends.end(), _type_ends.begin() );
+  return taken;
+}
+
+/// Stop applying a shared behavior to an entity.
+inline void removeBehavior( entityx::Entity entity, const SharedBehaviorRef &behavior )
+{
+  auto component = entity.component<BehaviorComponent>();
+  if (component) {
+    auto &b = component->shared_behaviors;
+    auto iter = std::find( b.begin(), b.end(), behavior );
+    if( iter != b.end() ) {
+      // Keep our reference until the behavior has finished removing the entity.
+      auto removed = std::move( *iter );
+      b.erase( iter );
+      removed->remove( entity );
+    }
+  }
+}
+
+inline ci::vec2 BehaviorBase::mouseDelta() const
+{
+  auto entity = _entity;
+  auto component = entity.component<BehaviorComponent>();
+  return component ? component->store->mouseDelta() : ci::vec2( 0 );
+}
+
+inline void BehaviorBase::setSchedule( Schedule schedule, double interval )
+{
+  _schedule = schedule;
+  _interval = interval;
+  _elapsed = 0;
+  // Behaviors that set a schedule in their constructor are staggered once the pool assigns their slot.
+  if( _pool ) {
+    staggerSchedule();
+  }
+}
+
+inline void BehaviorBase::staggerSchedule()
+{
+  switch( _schedule ) {
+    case Schedule::EveryFrame:
+      _countdown = 0;
+      break;
+    case Schedule::Frames:
+      _countdown = _slot % static_cast<size_t>( _interval );
+      break;
+    case Schedule::Seconds:
+      // Golden ratio steps spread any run of consecutive slots evenly over the interval.
+      _countdown = _interval * std::fmod( _slot * 0.6180339887, 1.0 );
+      break;
+  }
+}
+
+inline bool BehaviorBase::tick( entityx::TimeDelta dt, entityx::TimeDelta *elapsed )
+{
+  if( _schedule == Schedule::EveryFrame ) {
+    *elapsed = dt;
+    return true;
+  }
+
+  _elapsed += dt;
+  _countdown -= (_schedule == Schedule::Frames) ? 1.0 : dt;
+  if( _countdown > 0 ) {
+    return false;
+  }
+
+  // After a long frame, start a fresh interval rather than running again to catch up.
+  _countdown = std::max( _countdown + _interval, 0.0 );
+  *elapsed = _elapsed;
+  _elapsed = 0;
+  return true;
 }
 
-void BehaviorBase::remove()
+inline void BehaviorBase::remove()
 {
-  removeBehavior(entity(), this);
+  // Removal may destroy this behavior right away, so let go of the entity first.
+  auto entity = _entity;
   _entity.invalidate();
+  removeBehavior(entity, this);
 }
 
 } // namespace soso
@@ -0,0 +1,90 @@
+//
+//  BehaviorStore.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "BehaviorStore.h"
+#include "Behavior.h"
+#include "CoroutineScheduler.h"
+#include "SharedBehavior.h"
+
+using namespace soso;
+
+std::atomic<size_t> BehaviorStore::_next_type_index( 0 );
+
+BehaviorStore::BehaviorStore()
+: _coroutines( std::make_unique<CoroutineScheduler>() )
+{}
+
+BehaviorStore::~BehaviorStore() = default;
+
+void BehaviorStore::destroy( BehaviorBase *behavior )
+{
+  if( _iteration_depth > 0 ) {
+    behavior->_pool->deactivate( behavior );
+    _retired.push_back( behavior );
+  }
+  else {
+    behavior->_pool->destroy( behavior );
+  }
+}
+
+void BehaviorStore::addShared( const std::shared_ptr<SharedBehavior> &behavior )
+{
+  _shared_behaviors.push_back( behavior );
+}
+
+void BehaviorStore::removeShared( SharedBehavior *behavior )
+{
+  auto iter = std::find_if( _shared_behaviors.begin(), _shared_behaviors.end(), [behavior] (const std::shared_ptr<SharedBehavior> &b) {
+    return b.get() == behavior;
+  } );
+  if( iter == _shared_behaviors.end() ) {
+    return;
+  }
+
+  if( _iteration_depth > 0 ) {
+    // It may be the behavior being updated; keep it alive and leave a hole so indices don't shift.
+    _retired_shared.push_back( std::move( *iter ) );
+    *iter = nullptr;
+  }
+  else {
+    _shared_behaviors.erase( iter );
+  }
+}
+
+void BehaviorStore::update( entityx::TimeDelta dt, WorkerPool *workers )
+{
+  eachPool( _update_pools, [dt, workers] (BehaviorPoolBase &pool) { pool.update( dt, workers ); } );
+  iterate( [this, dt] {
+    // Shared behaviors may be added while iterating, so index rather than holding iterators.
+    for( size_t i = 0; i < _shared_behaviors.size(); i += 1 ) {
+      if( auto *behavior = _shared_behaviors[i].get() ) {
+        behavior->runUpdate( dt );
+      }
+    }
+  } );
+  iterate( [this, dt] { _coroutines->update( dt ); } );
+}
+
+void BehaviorStore::mouseMove( const ci::app::MouseEvent &event, const ci::vec2 &delta )
+{
+  dispatchMouse( _mouse_move_pools, delta, [&event] (BehaviorPoolBase &pool) { pool.mouseMove( event ); } );
+}
+
+void BehaviorStore::mouseDrag( const ci::app::MouseEvent &event, const ci::vec2 &delta )
+{
+  dispatchMouse( _mouse_drag_pools, delta, [&event] (BehaviorPoolBase &pool) { pool.mouseDrag( event ); } );
+}
+
+void BehaviorStore::mouseDown( const ci::app::MouseEvent &event, const ci::vec2 &delta )
+{
+  dispatchMouse( _mouse_down_pools, delta, [&event] (BehaviorPoolBase &pool) { pool.mouseDown( event ); } );
+}
+
+void BehaviorStore::mouseUp( const ci::app::MouseEvent &event, const ci::vec2 &delta )
+{
+  dispatchMouse( _mouse_up_pools, delta, [&event] (BehaviorPoolBase &pool) { pool.mouseUp( event ); } );
+}
@@ -0,0 +1,385 @@
+//
+//  BehaviorStore.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "entityx/Entity.h"
+#include "cinder/Vector.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace soso {
+
+class BehaviorBase;
+class CoroutineScheduler;
+class SharedBehavior;
+
+///
+/// Which of BehaviorBase's handlers a behavior type overrides, detected at compile time.
+/// A handler that isn't overridden still has BehaviorBase's member function pointer type.
+///
+template <typename B>
+struct BehaviorHandlers
+{
+  using UpdateHandler = void (BehaviorBase::*)( entityx::TimeDelta );
+  using MouseHandler = void (BehaviorBase::*)( const ci::app::MouseEvent & );
+
+  static constexpr bool update = ! std::is_same<decltype(&B::update), UpdateHandler>::value;
+  static constexpr bool mouse_move = ! std::is_same<decltype(&B::mouseMove), MouseHandler>::value;
+  static constexpr bool mouse_drag = ! std::is_same<decltype(&B::mouseDrag), MouseHandler>::value;
+  static constexpr bool mouse_down = ! std::is_same<decltype(&B::mouseDown), MouseHandler>::value;
+  static constexpr bool mouse_up = ! std::is_same<decltype(&B::mouseUp), MouseHandler>::value;
+  /// Whether B's update may run on worker threads. See BehaviorBase::EntityLocal.
+  static constexpr bool entity_local = B::EntityLocal;
+};
+
+///
+/// Type-erased interface to a pool of behaviors of one concrete type.
+/// The store makes one virtual call per pool; calls within a pool are statically dispatched.
+///
+class BehaviorPoolBase
+{
+public:
+  virtual ~BehaviorPoolBase() = default;
+
+  /// Stops a behavior from receiving calls, without destroying it yet.
+  virtual void deactivate( BehaviorBase *behavior ) = 0;
+  /// Destroys a behavior and frees its slot for reuse.
+  virtual void destroy( BehaviorBase *behavior ) = 0;
+  /// Number of behaviors that haven't been destroyed or deactivated.
+  virtual size_t count() const = 0;
+  /// Returns true if a behavior hasn't been deactivated.
+  virtual bool active( const BehaviorBase *behavior ) const = 0;
+
+  /// Updates every behavior, spreading the work across workers if it is given and the behavior type is entity-local.
+  virtual void update( entityx::TimeDelta dt, WorkerPool *workers ) = 0;
+  virtual void mouseMove( const ci::app::MouseEvent &event ) = 0;
+  virtual void mouseDrag( const ci::app::MouseEvent &event ) = 0;
+  virtual void mouseDown( const ci::app::MouseEvent &event ) = 0;
+  virtual void mouseUp( const ci::app::MouseEvent &event ) = 0;
+};
+
+///
+/// Stores behaviors of type B contiguously, in fixed-size chunks so their addresses never change.
+/// Destroyed behaviors leave a hole that the next created behavior fills,
+/// except while the pool is calling into its behaviors, when new behaviors go past the end.
+///
+template <typename B>
+class BehaviorPool : public BehaviorPoolBase
+{
+public:
+  static const size_t ChunkSize = 64;
+
+  explicit BehaviorPool( size_t type )
+  : _type( type )
+  {}
+  BehaviorPool( const BehaviorPool & ) = delete;
+  BehaviorPool& operator=( const BehaviorPool & ) = delete;
+
+  ~BehaviorPool() override
+  {
+    for( size_t i = 0; i < _size; i += 1 ) {
+      if( alive( i ) ) {
+        at( i )->~B();
+      }
+    }
+  }
+
+  template <typename ... Params>
+  B* create( entityx::Entity entity, Params&& ... params )
+  {
+    size_t slot;
+    // Holes may be below the end of a pass in progress, which would then call into the new behavior.
+    if( ! _free_slots.empty() && _iteration_depth == 0 ) {
+      slot = _free_slots.back();
+      _free_slots.pop_back();
+    }
+    else {
+      slot = _size;
+      _size += 1;
+      if( slot / ChunkSize == _chunks.size() ) {
+        _chunks.push_back( std::make_unique<Chunk>() );
+      }
+    }
+
+    auto *behavior = new (&chunk( slot ).storage[slot % ChunkSize]) B( entity, std::forward<Params>( params ) ... );
+    behavior->_pool = this;
+    behavior->_slot = slot;
+    behavior->_type = _type;
+    behavior->staggerSchedule();
+    chunk( slot ).alive[slot % ChunkSize] = true;
+    _count += 1;
+    return behavior;
+  }
+
+  void deactivate( BehaviorBase *behavior ) override
+  {
+    setDead( static_cast<B*>( behavior )->_slot );
+  }
+
+  void destroy( BehaviorBase *behavior ) override
+  {
+    auto *b = static_cast<B*>( behavior );
+    auto slot = b->_slot;
+    setDead( slot );
+    b->~B();
+    _free_slots.push_back( slot );
+  }
+
+  size_t count() const override { return _count; }
+  bool active( const BehaviorBase *behavior ) const override { return alive( static_cast<const B*>( behavior )->_slot ); }
+
+  /// Behaviors created during a call won't receive it until the next one.
+  /// Behaviors with a schedule (e.g. updateEvery) are only updated when it comes due.
+  void update( entityx::TimeDelta dt, WorkerPool *workers ) override;
+  void mouseMove( const ci::app::MouseEvent &event ) override { each( [&event] (B &b) { b.B::mouseMove( event ); } ); }
+  void mouseDrag( const ci::app::MouseEvent &event ) override { each( [&event] (B &b) { b.B::mouseDrag( event ); } ); }
+  void mouseDown( const ci::app::MouseEvent &event ) override { each( [&event] (B &b) { b.B::mouseDown( event ); } ); }
+  void mouseUp( const ci::app::MouseEvent &event ) override { each( [&event] (B &b) { b.B::mouseUp( event ); } ); }
+
+private:
+  struct Chunk
+  {
+    typename std::aligned_storage<sizeof(B), alignof(B)>::type storage[ChunkSize];
+    bool alive[ChunkSize] = {};
+  };
+
+  std::vector<std::unique_ptr<Chunk>> _chunks;
+  std::vector<size_t>                 _free_slots;
+  /// One past the highest slot ever used.
+  size_t                              _size = 0;
+  /// Number of live behaviors.
+  size_t                              _count = 0;
+  size_t                              _type;
+  /// Nonzero while calling into behaviors.
+  int                                 _iteration_depth = 0;
+
+  Chunk& chunk( size_t slot ) { return *_chunks[slot / ChunkSize]; }
+  const Chunk& chunk( size_t slot ) const { return *_chunks[slot / ChunkSize]; }
+  bool alive( size_t slot ) const { return chunk( slot ).alive[slot % ChunkSize]; }
+  void setDead( size_t slot )
+  {
+    if( alive( slot ) ) {
+      chunk( slot ).alive[slot % ChunkSize] = false;
+      _count -= 1;
+    }
+  }
+  B* at( size_t slot ) { return reinterpret_cast<B*>( &chunk( slot ).storage[slot % ChunkSize] ); }
+
+  static void updateBehavior( B &b, entityx::TimeDelta dt )
+  {
+    entityx::TimeDelta elapsed;
+    if( b.BehaviorBase::tick( dt, &elapsed ) ) {
+      b.B::update( elapsed );
+    }
+  }
+
+  template <typename Fn>
+  void each( const Fn &fn )
+  {
+    _iteration_depth += 1;
+    auto end = _size;
+    for( size_t i = 0; i < end; i += 1 ) {
+      if( alive( i ) ) {
+        fn( *at( i ) );
+      }
+    }
+    _iteration_depth -= 1;
+  }
+};
+
+///
+/// Owns every behavior in a world, grouped into one pool per concrete behavior type.
+/// Updating runs type by type, so each pool's loop is tight and statically dispatched.
+/// Each update and input event is only sent to pools whose behavior type overrides its handler,
+/// so dispatch cost scales with the number of interested behaviors.
+///
+/// Behaviors destroyed while the store is calling into them (e.g. a behavior that destroys its own entity)
+/// are deactivated immediately and destroyed once the outermost call finishes.
+///
+class BehaviorStore
+{
+public:
+  BehaviorStore();
+  ~BehaviorStore();
+
+  BehaviorStore( const BehaviorStore & ) = delete;
+  BehaviorStore& operator=( const BehaviorStore & ) = delete;
+
+  template <typename B, typename ... Params>
+  B* create( entityx::Entity entity, Params&& ... params ) { return pool<B>().create( entity, std::forward<Params>( params ) ... ); }
+  void destroy( BehaviorBase *behavior );
+
+  /// Starts updating a shared behavior. Called when it is first applied to an entity.
+  void addShared( const std::shared_ptr<SharedBehavior> &behavior );
+  /// Stops updating a shared behavior and lets go of it. Called when it is no longer applied to any entity.
+  void removeShared( SharedBehavior *behavior );
+
+  /// Updates every behavior. When workers are given, entity-local behavior types are updated across them,
+  /// one type at a time; all other types are updated on the calling thread.
+  /// Shared behaviors are updated next, then coroutine behaviors that are due are resumed.
+  void update( entityx::TimeDelta dt, WorkerPool *workers = nullptr );
+  /// Sends a mouse event to every interested behavior.
+  /// \a delta is the movement the event covers, e.g. since the previous event or summed over coalesced events.
+  void mouseMove( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
+  void mouseDrag( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
+  void mouseDown( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
+  void mouseUp( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
+  /// The delta of the mouse event being sent. Only meaningful inside mouse handlers.
+  const ci::vec2& mouseDelta() const { return _mouse_delta; }
+
+  /// Runs this store's suspended behaviors, e.g. CoroutineBehaviors.
+  CoroutineScheduler& coroutines() { return *_coroutines; }
+
+  /// Returns the number of live behaviors of exactly type B.
+  template <typename B>
+  size_t count() const;
+
+  /// Returns a small index unique to each behavior type, for looking up its pool and an entity's behaviors of that type.
+  /// Assigned the first time it is requested for a type, so no RTTI is needed.
+  template <typename B>
+  static size_t typeIndex() {
+    static const size_t index = _next_type_index++;
+    return index;
+  }
+
+private:
+  /// Pools indexed by behavior type. Types that were never created have no pool.
+  std::vector<std::unique_ptr<BehaviorPoolBase>> _pools;
+  /// Pools subscribed to each event.
+  std::vector<BehaviorPoolBase*>                 _update_pools;
+  std::vector<BehaviorPoolBase*>                 _mouse_move_pools;
+  std::vector<BehaviorPoolBase*>                 _mouse_drag_pools;
+  std::vector<BehaviorPoolBase*>                 _mouse_down_pools;
+  std::vector<BehaviorPoolBase*>                 _mouse_up_pools;
+  /// Shared behaviors applied to at least one entity. Entries removed during iteration are null until it finishes.
+  std::vector<std::shared_ptr<SharedBehavior>>   _shared_behaviors;
+  /// Behaviors destroyed during iteration, waiting to be destroyed for real.
+  std::vector<BehaviorBase*>                     _retired;
+  /// Shared behaviors removed during iteration, kept alive until it finishes.
+  std::vector<std::shared_ptr<SharedBehavior>>   _retired_shared;
+  int                                            _iteration_depth = 0;
+  std::unique_ptr<CoroutineScheduler>            _coroutines;
+  ci::vec2                                       _mouse_delta;
+
+  static std::atomic<size_t>                     _next_type_index;
+
+  template <typename B>
+  BehaviorPool<B>& pool();
+
+  /// Calls fn on every pool in a subscriber list, deferring destruction until the outermost call finishes.
+  template <typename Fn>
+  void eachPool( const std::vector<BehaviorPoolBase*> &pools, const Fn &fn );
+  /// Calls fn, deferring destruction of behaviors until the outermost call finishes.
+  template <typename Fn>
+  void iterate( const Fn &fn );
+  /// Sends a mouse event to every pool in a subscriber list, with its delta available to handlers.
+  template <typename Fn>
+  void dispatchMouse( const std::vector<BehaviorPoolBase*> &pools, const ci::vec2 &delta, const Fn &fn );
+};
+
+#pragma mark - Template Implementation
+
+template <typename B>
+void BehaviorPool<B>::update( entityx::TimeDelta dt, WorkerPool *workers )
+{
+  if( BehaviorHandlers<B>::entity_local && workers && _chunks.size() > 1 )
+  {
+    // Each chunk is a task. Behaviors of one type on different entities never touch the same components.
+    _iteration_depth += 1;
+    auto end = _size;
+    workers->parallelFor( _chunks.size(), [this, dt, end] (size_t c) {
+      auto chunk_end = std::min( (c + 1) * ChunkSize, end );
+      for( auto i = c * ChunkSize; i < chunk_end; i += 1 ) {
+        if( alive( i ) ) {
+          updateBehavior( *at( i ), dt );
+        }
+      }
+    } );
+    _iteration_depth -= 1;
+  }
+  else
+  {
+    each( [dt] (B &b) { updateBehavior( b, dt ); } );
+  }
+}
+
+template <typename B>
+BehaviorPool<B>& BehaviorStore::pool()
+{
+  auto index = typeIndex<B>();
+  if( index >= _pools.size() ) {
+    _pools.resize( index + 1 );
+  }
+  if( ! _pools[index] ) {
+    _pools[index] = std::make_unique<BehaviorPool<B>>( index );
+
+    using Handlers = BehaviorHandlers<B>;
+    auto *added = _pools[index].get();
+    if( Handlers::update ) { _update_pools.push_back( added ); }
+    if( Handlers::mouse_move ) { _mouse_move_pools.push_back( added ); }
+    if( Handlers::mouse_drag ) { _mouse_drag_pools.push_back( added ); }
+    if( Handlers::mouse_down ) { _mouse_down_pools.push_back( added ); }
+    if( Handlers::mouse_up ) { _mouse_up_pools.push_back( added ); }
+  }
+  return static_cast<BehaviorPool<B>&>( *_pools[index] );
+}
+
+template <typename B>
+size_t BehaviorStore::count() const
+{
+  auto index = typeIndex<B>();
+  return (index < _pools.size() && _pools[index]) ? _pools[index]->count() : 0;
+}
+
+template <typename Fn>
+void BehaviorStore::eachPool( const std::vector<BehaviorPoolBase*> &pools, const Fn &fn )
+{
+  iterate( [&pools, &fn] {
+    // Pools may be added while iterating, so index rather than holding iterators.
+    for( size_t i = 0; i < pools.size(); i += 1 ) {
+      fn( *pools[i] );
+    }
+  } );
+}
+
+template <typename Fn>
+void BehaviorStore::dispatchMouse( const std::vector<BehaviorPoolBase*> &pools, const ci::vec2 &delta, const Fn &fn )
+{
+  // A handler may send another event, so restore the outer event's delta afterward.
+  auto outer_delta = _mouse_delta;
+  _mouse_delta = delta;
+  eachPool( pools, fn );
+  _mouse_delta = outer_delta;
+}
+
+template <typename Fn>
+void BehaviorStore::iterate( const Fn &fn )
+{
+  _iteration_depth += 1;
+  fn();
+  _iteration_depth -= 1;
+
+  if( _iteration_depth == 0 && ! _retired.empty() ) {
+    auto retired = std::move( _retired );
+    _retired.clear();
+    for( auto *behavior : retired ) {
+      destroy( behavior );
+    }
+  }
+
+  if( _iteration_depth == 0 && ! _retired_shared.empty() ) {
+    _shared_behaviors.erase( std::remove( _shared_behaviors.begin(), _shared_behaviors.end(), nullptr ), _shared_behaviors.end() );
+    _retired_shared.clear();
+  }
+}
+
+} // namespace soso
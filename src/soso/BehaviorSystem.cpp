@@ -15,79 +15,63 @@ using namespace cinder::app;
 using namespace entityx;
 
 BehaviorSystem::BehaviorSystem( entityx::EntityManager &entities )
-: _entities( entities )
+: _input( app::getWindow() ),
+  _entities( entities )
+{}
+
+void BehaviorSystem::configure( EventManager &events )
 {
-  auto window = app::getWindow();
-  auto mouse_move = [this] (MouseEvent &event) { mouseMove( event ); };
-  auto mouse_down = [this] (MouseEvent &event) { mouseDown( event ); };
-  auto mouse_drag = [this] (MouseEvent &event) { mouseDrag( event ); };
-  auto mouse_up = [this] (MouseEvent &event) { mouseUp( event ); };
+  events.subscribe<ComponentAddedEvent<BehaviorComponent>>( *this );
+}
 
-  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseMove().connect( mouse_move ) ) );
-  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseDown().connect( mouse_down ) ) );
-  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseDrag().connect( mouse_drag ) ) );
-  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseUp().connect( mouse_up ) ) );
+void BehaviorSystem::receive( const ComponentAddedEvent<BehaviorComponent> &event )
+{
+  auto component = event.component;
+  component->store = _store;
+  component->entity = event.entity;
 }
 
-void BehaviorSystem::mouseDown( const ci::app::MouseEvent &event )
+void BehaviorSystem::mouseDown( const ci::app::MouseEvent &event, const ci::vec2 &delta )
 {
-  ComponentHandle<BehaviorComponent> behavior;
-  for( auto __unused e : _entities.entities_with_components( behavior ) )
-  {
-    auto &behaviors = behavior->behaviors;
-    for( auto &b : behaviors ) {
-      b->mouseDown( event );
-    }
-  }
+  _store->mouseDown( event, delta );
 }
 
-void BehaviorSystem::mouseDrag( const ci::app::MouseEvent &event )
+void BehaviorSystem::mouseDrag( const ci::app::MouseEvent &event, const ci::vec2 &delta )
 {
-  ComponentHandle<BehaviorComponent> behavior;
-  for( auto __unused e : _entities.entities_with_components( behavior ) )
-  {
-    auto &behaviors = behavior->behaviors;
-    for( auto &b : behaviors ) {
-      b->mouseDrag( event );
-    }
-  }
+  _store->mouseDrag( event, delta );
 }
 
-void BehaviorSystem::mouseMove( const ci::app::MouseEvent &event )
+void BehaviorSystem::mouseMove( const ci::app::MouseEvent &event, const ci::vec2 &delta )
 {
-  ComponentHandle<BehaviorComponent> behavior;
-  for( auto __unused e : _entities.entities_with_components( behavior ) )
-  {
-    auto &behaviors = behavior->behaviors;
-    for( auto &b : behaviors ) {
-      b->mouseMove( event );
-    }
-  }
+  _store->mouseMove( event, delta );
 }
 
-void BehaviorSystem::mouseUp( const ci::app::MouseEvent &event )
+void BehaviorSystem::mouseUp( const ci::app::MouseEvent &event, const ci::vec2 &delta )
 {
-  ComponentHandle<BehaviorComponent> behavior;
-  for( auto __unused e : _entities.entities_with_components( behavior ) )
-  {
-    auto &behaviors = behavior->behaviors;
-    for( auto &b : behaviors ) {
-      b->mouseUp( event );
-    }
-  }
+  _store->mouseUp( event, delta );
 }
 
 void BehaviorSystem::update( EntityManager &entities, EventManager &events, TimeDelta dt )
 {
-
-  ComponentHandle<BehaviorComponent> behavior;
-
-  for( auto __unused e : entities.entities_with_components( behavior ) )
-  {
-    auto &behaviors = behavior->behaviors;
-    for( auto &b : behaviors ) {
-      b->update( dt );
+  _input.dispatch( [this] (const InputQueue::MouseInput &input) {
+    switch( input.type ) {
+      case InputQueue::Type::MouseMove:
+        mouseMove( input.event, input.delta );
+        break;
+      case InputQueue::Type::MouseDrag:
+        mouseDrag( input.event, input.delta );
+        break;
+      case InputQueue::Type::MouseDown:
+        mouseDown( input.event, input.delta );
+        break;
+      case InputQueue::Type::MouseUp:
+        mouseUp( input.event, input.delta );
+        break;
     }
-  }
+  } );
 
+  if( _parallel && ! _worker_pool ) {
+    _worker_pool = std::make_shared<WorkerPool>();
+  }
+  _store->update( dt, _parallel ? _worker_pool.get() : nullptr );
 }
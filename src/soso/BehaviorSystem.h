@@ -8,25 +8,52 @@
 #pragma once
 
 #include "entityx/System.h"
+#include "Behavior.h"
+#include "InputQueue.h"
 
 namespace soso {
 
-class BehaviorSystem : public entityx::System<BehaviorSystem>
+///
+/// Updates all behaviors and forwards mouse input to them.
+/// Behaviors are kept in a BehaviorStore, grouped by type, and updated one type at a time.
+/// Mouse input is queued as it arrives and dispatched at the start of update, before behaviors update.
+/// Behavior types marked EntityLocal can optionally be updated across a pool of worker threads.
+///
+class BehaviorSystem : public entityx::System<BehaviorSystem>, public entityx::Receiver<BehaviorSystem>
 {
 public:
   explicit BehaviorSystem(entityx::EntityManager &entities);
 
+  void configure( entityx::EventManager &events ) override;
   void update( entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt ) override;
 
-  void mouseMove( const ci::app::MouseEvent &event );
-  void mouseDown( const ci::app::MouseEvent &event );
-  void mouseDrag( const ci::app::MouseEvent &event );
-  void mouseUp( const ci::app::MouseEvent &event );
+  /// Switch between updating entity-local behaviors on the calling thread or across a pool of worker threads.
+  void setParallel( bool parallel ) { _parallel = parallel; }
+  bool isParallel() const { return _parallel; }
+  /// Use a specific pool for parallel updates, e.g. to share worker threads between systems.
+  /// If none is provided, one is created the first time a parallel update runs.
+  void setWorkerPool( const std::shared_ptr<WorkerPool> &pool ) { _worker_pool = pool; }
+
+  /// Returns the number of behaviors of exactly type B in the world.
+  template <typename B>
+  size_t numBehaviors() const { return _store->count<B>(); }
+
+  /// Hooks new BehaviorComponents up to our store.
+  void receive( const entityx::ComponentAddedEvent<BehaviorComponent> &event );
+
+  /// Send an event straight to behaviors. Window events go through the input queue and arrive here during update,
+  /// with \a delta covering the movement of every event coalesced into them. See BehaviorBase::mouseDelta.
+  void mouseMove( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
+  void mouseDown( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
+  void mouseDrag( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
+  void mouseUp( const ci::app::MouseEvent &event, const ci::vec2 &delta = ci::vec2( 0 ) );
 
 private:
-  using ScopedConnectionRef = std::shared_ptr<ci::signals::ScopedConnection>;
-  std::vector<ScopedConnectionRef> _signal_connections;
+  InputQueue                      _input;
   entityx::EntityManager          &_entities;
+  std::shared_ptr<BehaviorStore>  _store = std::make_shared<BehaviorStore>();
+  bool                            _parallel = false;
+  std::shared_ptr<WorkerPool>     _worker_pool;
 };
 
 } // namespace soso
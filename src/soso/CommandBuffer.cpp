@@ -0,0 +1,62 @@
+//
+//  CommandBuffer.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "CommandBuffer.h"
+#include <algorithm>
+
+using namespace soso;
+using namespace entityx;
+
+void CommandBuffer::create( const std::function<void (Entity)> &setup )
+{
+  _commands.push_back( [setup] (EntityManager &entities) {
+    auto entity = entities.create();
+    if( setup ) {
+      setup( entity );
+    }
+  } );
+}
+
+void CommandBuffer::destroy( Entity entity )
+{
+  _destroyed.push_back( entity );
+}
+
+void CommandBuffer::defer( const std::function<void ()> &fn )
+{
+  _commands.push_back( [fn] (EntityManager &) { fn(); } );
+}
+
+void CommandBuffer::flush( EntityManager &entities )
+{
+  std::vector<Command> commands;
+  std::vector<Entity>  destroyed;
+
+  while( ! empty() ) {
+    // Swap out our lists so that commands can safely record more commands.
+    std::swap( commands, _commands );
+    for( auto &command : commands ) {
+      command( entities );
+    }
+    commands.clear();
+
+    if( ! _commands.empty() ) {
+      continue;
+    }
+
+    std::swap( destroyed, _destroyed );
+    std::sort( destroyed.begin(), destroyed.end() );
+    destroyed.erase( std::unique( destroyed.begin(), destroyed.end() ), destroyed.end() );
+    for( auto &entity : destroyed ) {
+      // Destroying one entity (e.g. a hierarchy root) may already have destroyed another.
+      if( entity.valid() ) {
+        entity.destroy();
+      }
+    }
+    destroyed.clear();
+  }
+}
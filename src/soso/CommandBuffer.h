@@ -0,0 +1,84 @@
+//
+//  CommandBuffer.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "entityx/Entity.h"
+#include <functional>
+#include <vector>
+
+namespace soso {
+
+///
+/// Records structural changes to a world (creating, destroying, assigning and removing)
+/// so they can be made while iterating over entities and applied together afterward.
+///
+/// flush() applies everything in the order it was recorded, then destroys entities in one batch.
+/// Destroys are deduplicated, and commands targeting entities that are no longer valid are skipped.
+/// Commands recorded during a flush are applied in the same flush.
+///
+class CommandBuffer
+{
+public:
+  using Command = std::function<void (entityx::EntityManager &)>;
+
+  CommandBuffer() = default;
+
+  CommandBuffer( const CommandBuffer & ) = delete;
+  CommandBuffer& operator=( const CommandBuffer & ) = delete;
+
+  /// Creates an entity at flush and passes it to setup, which can assign its components.
+  void create( const std::function<void (entityx::Entity)> &setup );
+  /// Destroys an entity at the end of the flush.
+  void destroy( entityx::Entity entity );
+
+  /// Assigns a component at flush. The component is constructed now and moved in at flush.
+  template <typename C, typename ... Params>
+  void assign( entityx::Entity entity, Params&& ... params );
+
+  /// Removes a component at flush, if the entity still has it.
+  template <typename C>
+  void remove( entityx::Entity entity );
+
+  /// Calls an arbitrary function at flush, before any destroys.
+  /// Use for follow-up work that reads entities about to be destroyed.
+  void defer( const std::function<void ()> &fn );
+
+  /// Applies all recorded commands to entities.
+  void flush( entityx::EntityManager &entities );
+
+  bool empty() const { return _commands.empty() && _destroyed.empty(); }
+
+private:
+  std::vector<Command>          _commands;
+  std::vector<entityx::Entity>  _destroyed;
+};
+
+#pragma mark - Template Implementation
+
+template <typename C, typename ... Params>
+void CommandBuffer::assign( entityx::Entity entity, Params&& ... params )
+{
+  auto component = std::make_shared<C>( std::forward<Params>( params ) ... );
+  _commands.push_back( [entity, component] (entityx::EntityManager &) mutable {
+    if( entity.valid() ) {
+      entity.assign<C>( std::move( *component ) );
+    }
+  } );
+}
+
+template <typename C>
+void CommandBuffer::remove( entityx::Entity entity )
+{
+  _commands.push_back( [entity] (entityx::EntityManager &) mutable {
+    if( entity.valid() && entity.has_component<C>() ) {
+      entity.remove<C>();
+    }
+  } );
+}
+
+} // namespace soso
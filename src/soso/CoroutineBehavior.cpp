@@ -0,0 +1,80 @@
+//
+//  CoroutineBehavior.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "CoroutineBehavior.h"
+
+#if defined(__cpp_impl_coroutine)
+
+using namespace soso;
+
+#pragma mark - BehaviorEvent
+
+void BehaviorEvent::notify()
+{
+  auto waiters = std::move( _waiters );
+  _waiters.clear();
+  for( auto &waiter : waiters ) {
+    if( auto resumable = waiter.lock() ) {
+      resumable->scheduler->resumeNextUpdate( resumable );
+    }
+  }
+}
+
+#pragma mark - CoroutineBehavior
+
+CoroutineBehavior::CoroutineBehavior( entityx::Entity entity )
+: BehaviorBase( entity )
+{
+  auto &scheduler = entity.component<BehaviorComponent>()->store->coroutines();
+  _resumable = std::make_shared<CoroutineResumable>( CoroutineResumable{ this, [this] { step(); }, &scheduler } );
+  // run() is virtual, so wait until we are fully constructed to call it.
+  scheduler.resumeNextUpdate( _resumable );
+}
+
+CoroutineBehavior::~CoroutineBehavior()
+{
+  // Cancel before letting go of the coroutine frame, so nothing can try to resume it.
+  _resumable->cancel();
+  _task = BehaviorTask();
+}
+
+void CoroutineBehavior::step()
+{
+  if( ! _task.handle() ) {
+    _task = run();
+    _task.handle().promise().resumable = _resumable;
+  }
+  _task.handle().resume();
+
+  // The scheduler runs inside the store's iteration, so we are still here even if the coroutine removed us.
+  if( _task.handle().done() && active() ) {
+    remove();
+  }
+}
+
+void CoroutineBehavior::WaitAwaiter::await_suspend( BehaviorTask::Handle handle )
+{
+  if( auto resumable = handle.promise().resumable.lock() ) {
+    resumable->scheduler->resumeAfter( resumable, seconds );
+  }
+}
+
+void CoroutineBehavior::NextFrameAwaiter::await_suspend( BehaviorTask::Handle handle )
+{
+  if( auto resumable = handle.promise().resumable.lock() ) {
+    resumable->scheduler->resumeNextUpdate( resumable );
+  }
+}
+
+void CoroutineBehavior::ConditionAwaiter::await_suspend( BehaviorTask::Handle handle )
+{
+  if( auto resumable = handle.promise().resumable.lock() ) {
+    resumable->scheduler->resumeWhen( resumable, condition );
+  }
+}
+
+#endif
@@ -0,0 +1,160 @@
+//
+//  CoroutineBehavior.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "Behavior.h"
+#include "CoroutineScheduler.h"
+
+// Coroutine behaviors need C++20. Under earlier standards this header provides nothing.
+// It only adds types of its own, so translation units built either way agree on everything else.
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <functional>
+#include <utility>
+
+namespace soso {
+
+///
+/// The return type of CoroutineBehavior::run().
+///
+class BehaviorTask
+{
+public:
+  struct promise_type
+  {
+    BehaviorTask get_return_object() { return BehaviorTask( std::coroutine_handle<promise_type>::from_promise( *this ) ); }
+    /// Don't start running until the scheduler resumes us.
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    /// Stay suspended at the end so the scheduler can see we're done before the frame is destroyed.
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+
+    /// Lets awaiters find the coroutine's scheduler from its handle.
+    CoroutineResumableWeakRef resumable;
+  };
+  using Handle = std::coroutine_handle<promise_type>;
+
+  BehaviorTask() = default;
+  BehaviorTask( BehaviorTask &&other ) noexcept : _handle( std::exchange( other._handle, nullptr ) ) {}
+  BehaviorTask& operator=( BehaviorTask &&other ) noexcept { std::swap( _handle, other._handle ); return *this; }
+  BehaviorTask( const BehaviorTask & ) = delete;
+  BehaviorTask& operator=( const BehaviorTask & ) = delete;
+  ~BehaviorTask() { if( _handle ) { _handle.destroy(); } }
+
+  Handle handle() const { return _handle; }
+
+private:
+  explicit BehaviorTask( Handle handle )
+  : _handle( handle )
+  {}
+
+  Handle _handle;
+};
+
+///
+/// Something coroutine behaviors can wait for, e.g. a cue shared by many entities.
+/// co_await an event to suspend until the next call to notify().
+///
+class BehaviorEvent
+{
+public:
+  struct Awaiter
+  {
+    BehaviorEvent *event;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend( BehaviorTask::Handle handle ) { event->_waiters.push_back( handle.promise().resumable ); }
+    void await_resume() const noexcept {}
+  };
+
+  /// Wakes every coroutine currently waiting. They resume on their scheduler's next update.
+  void notify();
+
+  Awaiter operator co_await() { return Awaiter{ this }; }
+
+private:
+  std::vector<CoroutineResumableWeakRef> _waiters;
+};
+
+///
+/// A behavior written as a coroutine, for sequences like wait, move, wait, fade.
+/// Override run() and co_await wait(), nextFrame(), waitUntil() or a BehaviorEvent between steps.
+/// While suspended the behavior isn't called at all, and it never receives update().
+/// When run() returns, the behavior removes itself from its entity.
+/// Once the behavior is removed, its coroutine is never resumed again, even if it was waiting.
+///
+/// class Blink : public CoroutineBehavior {
+/// public:
+///   using CoroutineBehavior::CoroutineBehavior;
+///   BehaviorTask run() override {
+///     auto circle = entity().component<Circle>();
+///     for( int i = 0; i < 3; i += 1 ) {
+///       circle->color = Color::white();
+///       co_await wait( 0.5 );
+///       circle->color = Color::black();
+///       co_await wait( 0.5 );
+///     }
+///   }
+/// };
+///
+class CoroutineBehavior : public BehaviorBase
+{
+public:
+  /// Requires a configured BehaviorSystem. run() starts on its next update.
+  explicit CoroutineBehavior( entityx::Entity entity );
+  ~CoroutineBehavior() override;
+
+  /// The body of the behavior. Called once, on the first update after the behavior is created.
+  virtual BehaviorTask run() = 0;
+
+protected:
+  struct WaitAwaiter
+  {
+    double seconds;
+
+    bool await_ready() const noexcept { return seconds <= 0; }
+    void await_suspend( BehaviorTask::Handle handle );
+    void await_resume() const noexcept {}
+  };
+
+  struct NextFrameAwaiter
+  {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend( BehaviorTask::Handle handle );
+    void await_resume() const noexcept {}
+  };
+
+  struct ConditionAwaiter
+  {
+    std::function<bool ()> condition;
+
+    bool await_ready() const { return condition(); }
+    void await_suspend( BehaviorTask::Handle handle );
+    void await_resume() const noexcept {}
+  };
+
+  /// Suspend for the given number of seconds of update time.
+  static WaitAwaiter wait( double seconds ) { return WaitAwaiter{ seconds }; }
+  /// Suspend until the next update.
+  static NextFrameAwaiter nextFrame() { return NextFrameAwaiter{}; }
+  /// Suspend until condition returns true. Checked once per update while waiting.
+  static ConditionAwaiter waitUntil( const std::function<bool ()> &condition ) { return ConditionAwaiter{ condition }; }
+
+private:
+  CoroutineResumableRef _resumable;
+  BehaviorTask          _task;
+
+  /// Calls run() the first time, then resumes the coroutine from where it suspended.
+  void step();
+};
+
+} // namespace soso
+
+#endif
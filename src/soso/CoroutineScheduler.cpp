@@ -0,0 +1,69 @@
+//
+//  CoroutineScheduler.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "CoroutineScheduler.h"
+#include "Behavior.h"
+
+#include <algorithm>
+
+using namespace soso;
+
+bool CoroutineResumable::active() const
+{
+  return behavior && behavior->active();
+}
+
+void CoroutineScheduler::update( entityx::TimeDelta dt )
+{
+  _time += dt;
+
+  // Collect everything that is ready before resuming anything, so behaviors that suspend again wait for the next update.
+  std::swap( _resuming, _ready );
+  while( ! _sleepers.empty() && _sleepers.top().wake_time <= _time ) {
+    _resuming.push_back( _sleepers.top().resumable );
+    _sleepers.pop();
+  }
+
+  auto end = std::remove_if( _conditions.begin(), _conditions.end(), [this] (const Condition &c) {
+    // Drop conditions of removed behaviors without checking them, since they may refer to what was removed.
+    auto resumable = c.resumable.lock();
+    if( ! resumable || ! resumable->active() ) {
+      return true;
+    }
+    if( c.condition() ) {
+      _resuming.push_back( c.resumable );
+      return true;
+    }
+    return false;
+  } );
+  _conditions.erase( end, _conditions.end() );
+
+  for( auto &resumable : _resuming ) {
+    resume( resumable );
+  }
+  _resuming.clear();
+}
+
+void CoroutineScheduler::resumeAfter( const CoroutineResumableWeakRef &resumable, double seconds )
+{
+  _sleepers.push( Sleeper{ _time + seconds, _sleep_order, resumable } );
+  _sleep_order += 1;
+}
+
+void CoroutineScheduler::resumeWhen( const CoroutineResumableWeakRef &resumable, const std::function<bool ()> &condition )
+{
+  _conditions.push_back( Condition{ condition, resumable } );
+}
+
+void CoroutineScheduler::resume( const CoroutineResumableWeakRef &weak_resumable )
+{
+  // Behaviors removed while we were updating stay in memory until the store finishes destroying them.
+  auto resumable = weak_resumable.lock();
+  if( resumable && resumable->active() ) {
+    resumable->resume();
+  }
+}
@@ -0,0 +1,99 @@
+//
+//  CoroutineScheduler.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "entityx/Entity.h"
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace soso {
+
+class BehaviorBase;
+class CoroutineScheduler;
+
+///
+/// A suspended behavior, as seen by the scheduler.
+/// Shared between the behavior and every queue it is waiting in, so queues hold weak references and skip behaviors that are gone.
+/// Behaviors that were removed from their entity are skipped too, even before the store has destroyed them.
+///
+struct CoroutineResumable
+{
+  BehaviorBase            *behavior = nullptr;
+  /// Continues the behavior from where it suspended.
+  std::function<void ()>  resume;
+  CoroutineScheduler      *scheduler = nullptr;
+
+  /// False once cancelled, or once the behavior has been removed.
+  bool active() const;
+  /// Stops the behavior from ever being resumed again.
+  void cancel() { behavior = nullptr; }
+};
+
+using CoroutineResumableRef = std::shared_ptr<CoroutineResumable>;
+using CoroutineResumableWeakRef = std::weak_ptr<CoroutineResumable>;
+
+///
+/// Runs suspended behaviors when what they are waiting for happens.
+/// Sleeping behaviors wait in a queue ordered by wake time, and behaviors waiting on events wait with the event,
+/// so neither costs anything per frame. Only waitUntil conditions are checked every update.
+///
+/// Each BehaviorStore has one scheduler, updated along with its behaviors.
+/// The scheduler doesn't need coroutines itself, so the store is the same under every language standard;
+/// CoroutineBehavior, which needs C++20, is what suspends behaviors into it.
+///
+class CoroutineScheduler
+{
+public:
+  CoroutineScheduler() = default;
+  CoroutineScheduler( const CoroutineScheduler & ) = delete;
+  CoroutineScheduler& operator=( const CoroutineScheduler & ) = delete;
+
+  /// Advances time and resumes every behavior that is ready to run.
+  void update( entityx::TimeDelta dt );
+
+  /// Seconds of update time elapsed.
+  double time() const { return _time; }
+
+  /// Resumes a behavior on the next update.
+  void resumeNextUpdate( const CoroutineResumableWeakRef &resumable ) { _ready.push_back( resumable ); }
+  /// Resumes a behavior on the first update at least \a seconds from now.
+  void resumeAfter( const CoroutineResumableWeakRef &resumable, double seconds );
+  /// Resumes a behavior on the first update where condition returns true.
+  void resumeWhen( const CoroutineResumableWeakRef &resumable, const std::function<bool ()> &condition );
+
+private:
+  struct Sleeper
+  {
+    double                    wake_time;
+    /// Breaks ties so sleepers with the same wake time resume in the order they slept.
+    uint64_t                  order;
+    CoroutineResumableWeakRef resumable;
+
+    bool operator>( const Sleeper &other ) const { return wake_time > other.wake_time || (wake_time == other.wake_time && order > other.order); }
+  };
+
+  struct Condition
+  {
+    std::function<bool ()>    condition;
+    CoroutineResumableWeakRef resumable;
+  };
+
+  double                                  _time = 0;
+  uint64_t                                _sleep_order = 0;
+  std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<Sleeper>> _sleepers;
+  std::vector<Condition>                  _conditions;
+  std::vector<CoroutineResumableWeakRef>  _ready;
+  /// Storage for the behaviors being resumed this update, reused between updates.
+  std::vector<CoroutineResumableWeakRef>  _resuming;
+
+  void resume( const CoroutineResumableWeakRef &resumable );
+};
+
+} // namespace soso
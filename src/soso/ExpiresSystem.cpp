@@ -19,9 +19,12 @@ void ExpiresSystem::update( EntityManager &entities, EventManager &events, TimeD
     ec->time -= dt;
     if (ec->time < 0.0f) {
       if (ec->last_wish) {
-        ec->last_wish(e);
+        auto last_wish = ec->last_wish;
+        _commands.defer([last_wish, e] { last_wish(e); });
       }
-      e.destroy();
+      _commands.destroy(e);
     }
   }
+
+  _commands.flush(entities);
 }
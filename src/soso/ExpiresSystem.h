@@ -8,16 +8,22 @@
 #pragma once
 
 #include "entityx/System.h"
+#include "CommandBuffer.h"
 
 namespace soso {
 
+///
+/// Counts down Expires components and destroys their entities when time runs out.
+/// Last wishes and destruction are deferred until every component has been counted down,
+/// so last wishes are free to create and destroy entities.
+///
 class ExpiresSystem : public entityx::System<ExpiresSystem>
 {
 public:
   void update( entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt ) override;
 
 private:
-
+  CommandBuffer _commands;
 };
 
 } // namespace soso
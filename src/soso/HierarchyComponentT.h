@@ -32,14 +32,13 @@ public:
   : _entity(entity)
   {}
   /// Remove references to self on destruction.
-  /// Also destroy all children when destroyed.
+  /// Also destroy all descendants when destroyed, without recursing.
   virtual ~HierarchyComponentT()
   {
-    removeFromParent();
-    for( auto &child : _children ) {
-      child->_parent = invalidHandle();
-      child->entity().destroy();
+    if( _parent ) {
+      _parent->removeChild( *this );
     }
+    destroyDescendants();
   }
 
   /// Append an entity to this hierarchy. Returns a handle to that entity's HierarchyComponentT.
@@ -51,48 +50,129 @@ public:
   /// Returns the entity this component is attached to.
   /// Used during iteration
   entityx::Entity entity() const { return _entity; }
+  /// Returns a handle to this component, looked up through its entity.
+  Handle handle() { return _entity.component<Derived>(); }
   /// Destroys this component's underlying entity (and hence this component).
   void destroy() { entity().destroy(); }
+  /// Detaches this branch and destroys it along with all of its descendants in one flat pass.
+  void destroySubtree();
 
   /// Returns true iff this is the root of a hierarchy (has no parent).
   bool isRoot() const { return ! _parent; }
   /// Returns true iff this is the leaf of a hierarchy (has no children).
-  bool isLeaf() const { return _children.empty(); }
-  /// Returns a handle to this branch's parent.
-  Handle parent() const { return _parent; }
-  /// Returns a reference to this branch's _children.
-  const std::vector<Handle>& children() const { return _children; }
+  bool isLeaf() const { return ! _first_child; }
+  /// Returns this branch's parent, or nullptr for roots.
+  Derived* parent() const { return _parent; }
+  Derived* firstChild() const { return _first_child; }
+  Derived* lastChild() const { return _last_child; }
+  Derived* nextSibling() const { return _next_sibling; }
+  Derived* previousSibling() const { return _previous_sibling; }
+
+  class ChildRange;
+  /// Returns a range over this branch's children, in the order they were appended.
+  ChildRange children() const { return ChildRange(_first_child); }
   /// Returns the number of direct _children in this hierarchy.
-  size_t numChildren() const { return _children.size(); }
-  size_t numDescendants() const;
+  size_t numChildren() const { return _num_children; }
+  /// Returns the number of nodes below this one. Kept up to date as branches are added and removed.
+  size_t numDescendants() const { return _num_descendants; }
+  /// Returns the number of ancestors above this node. Roots have depth 0.
+  size_t depth() const { return _depth; }
   void destroyChildren();
 
-  /// Visit all of this components' descendents depth-first. TODO: separate visitor patterns from data.
-  void descend(const std::function<void (const Derived &parent, Derived &child)> &fn);
-  /// Visit all of this components' ancestors. TODO: separate visitor patterns from data.
-  void ascend(const std::function<void (const Derived &child, Derived &parent)> &fn);
+  /// Returns true if branches were appended or removed anywhere below this node since the flag was last cleared.
+  /// Set on every ancestor of a change, so systems that cache the shape of a hierarchy (like TransformSystem)
+  /// can find what changed without visiting the rest.
+  bool hierarchyChanged() const { return _hierarchy_changed; }
+  void clearHierarchyChanged() { _hierarchy_changed = false; }
+  /// Returns true if this node's own children were appended or removed since the flag was last cleared.
+  bool childrenChanged() const { return _children_changed; }
+  void clearChildrenChanged() { _children_changed = false; }
 
-  /// Visit all of this components' descendents depth-first until the visitor function returns false.
-  /// Stops descending when function returns true.
-  void descendUntil(const std::function<bool (const Derived &parent, Derived &child)> &fn);
+  /// Visit all of this components' descendents depth-first, calling fn(const Derived &parent, Derived &child).
+  /// Visitors are templated so the callable is inlined, and traversal follows sibling and parent links rather than recursing.
+  template <typename Fn>
+  void descend(Fn &&fn);
+  /// Visit all of this components' ancestors, calling fn(const Derived &child, Derived &parent).
+  template <typename Fn>
+  void ascend(Fn &&fn);
 
-  /// Visit all of this components' ancestors until the visitor function returns false.
-  /// Stops ascending when function returns true.
-  void ascendUntil(const std::function<bool (const Derived &child, Derived &parent)> &fn);
+  /// Visit all of this components' descendents depth-first, calling bool fn(const Derived &parent, Derived &child).
+  /// When the visitor returns true, that child's descendants are skipped.
+  template <typename Fn>
+  void descendUntil(Fn &&fn);
+
+  /// Visit all of this components' ancestors, calling bool fn(const Derived &child, Derived &parent).
+  /// Stops ascending when the visitor returns true.
+  template <typename Fn>
+  void ascendUntil(Fn &&fn);
 
 private:
   entityx::Entity            _entity;
-  Handle                    _parent = invalidHandle();
-  std::vector<Handle>        _children;
+  /// Links to neighboring nodes. Components live in entityx's chunked pools, so their addresses are stable.
+  Derived                   *_parent = nullptr;
+  Derived                   *_first_child = nullptr;
+  Derived                   *_last_child = nullptr;
+  Derived                   *_next_sibling = nullptr;
+  Derived                   *_previous_sibling = nullptr;
+  size_t                    _num_children = 0;
+  size_t                    _num_descendants = 0;
+  size_t                    _depth = 0;
+  /// New components are new roots, so they start out changed.
+  bool                      _hierarchy_changed = true;
+  bool                      _children_changed = false;
+
+  /// Adjusts the descendant counts of this node and its ancestors, and flags them all as changed.
+  void propagateChange(std::ptrdiff_t descendant_delta);
+  /// Sets this node's depth and shifts its descendants to match.
+  void updateDepths(size_t depth);
+  /// Gathers all descendants, unlinks them, then destroys their entities.
+  /// Since every node is unlinked first, their destructors have no hierarchy work left to do.
+  /// Doesn't touch the rest of the hierarchy, so it is safe to call during destruction.
+  void destroyDescendants();
 
   /// Returns a pointer to this as derived type.
   Derived* self() { return static_cast<Derived*>(this); }
   const Derived* self() const { return static_cast<const Derived*>(this); }
-  /// Returns a handle to this component.
-  Handle handle() { return _entity.component<Derived>(); }
 
   /// Remove an entity from this hierarchy. Use handle->removeFromParent() to safely remove an item from its hierarchy.
-  void removeChild(entityx::ComponentHandle<Derived> handle);
+  /// Takes the child itself, since a component's handle is no longer valid while it is being destroyed.
+  void removeChild(HierarchyComponentT &child);
+};
+
+///
+/// Iterates over a node's children by following sibling links.
+///
+template <typename Derived>
+class HierarchyComponentT<Derived>::ChildRange
+{
+public:
+  class iterator
+  {
+  public:
+    explicit iterator(Derived *node)
+    : _node(node)
+    {}
+
+    Derived& operator*() const { return *_node; }
+    Derived* operator->() const { return _node; }
+    iterator& operator++() { _node = _node->_next_sibling; return *this; }
+    bool operator==(const iterator &other) const { return _node == other._node; }
+    bool operator!=(const iterator &other) const { return _node != other._node; }
+
+  private:
+    Derived *_node;
+  };
+
+  explicit ChildRange(Derived *first)
+  : _first(first)
+  {}
+
+  iterator begin() const { return iterator(_first); }
+  iterator end() const { return iterator(nullptr); }
+  bool empty() const { return ! _first; }
+
+private:
+  Derived *_first;
 };
 
 #pragma mark - Template Implementation
@@ -101,7 +181,8 @@ template <typename T>
 void HierarchyComponentT<T>::removeFromParent()
 {
   if( _parent ) {
-    _parent->removeChild( handle() );
+    _parent->removeChild( *this );
+    updateDepths( 0 );
   }
 }
 
@@ -120,88 +201,197 @@ typename HierarchyComponentT<T>::Handle HierarchyComponentT<T>::appendChild(enti
 template <typename T>
 void HierarchyComponentT<T>::appendChild(Handle child_handle)
 {
-  if (child_handle.get() != self()) {
-    child_handle->removeFromParent();
-    child_handle->_parent = handle();
-    _children.push_back(child_handle);
+  auto *child = child_handle.get();
+  if (child != self()) {
+    if (child->_parent) {
+      child->_parent->removeChild(*child);
+    }
+    child->_parent = self();
+    child->_previous_sibling = _last_child;
+    if (_last_child) {
+      _last_child->_next_sibling = child;
+    }
+    else {
+      _first_child = child;
+    }
+    _last_child = child;
+    _num_children += 1;
+    _children_changed = true;
+    child->updateDepths(_depth + 1);
+    propagateChange(child->_num_descendants + 1);
   }
 }
 
 template <typename T>
-void HierarchyComponentT<T>::removeChild(entityx::ComponentHandle<T> handle)
+void HierarchyComponentT<T>::removeChild(HierarchyComponentT &child)
 {
-  if (handle) {
-    handle->_parent = invalidHandle();
-    auto begin = std::remove_if(_children.begin(), _children.end(), [&](const Handle &e) { return e == handle; });
-    _children.erase(begin, _children.end());
+  if (child._previous_sibling) {
+    child._previous_sibling->_next_sibling = child._next_sibling;
+  }
+  else {
+    _first_child = child._next_sibling;
+  }
+  if (child._next_sibling) {
+    child._next_sibling->_previous_sibling = child._previous_sibling;
+  }
+  else {
+    _last_child = child._previous_sibling;
   }
+  _num_children -= 1;
+  _children_changed = true;
+
+  child._parent = nullptr;
+  child._next_sibling = nullptr;
+  child._previous_sibling = nullptr;
+  // The removed branch is now a root of its own.
+  // Its depths are left for removeFromParent to fix, so destruction doesn't walk a subtree that is about to go away.
+  child._hierarchy_changed = true;
+  propagateChange(- static_cast<std::ptrdiff_t>(child._num_descendants + 1));
 }
 
 template <typename T>
-size_t HierarchyComponentT<T>::numDescendants() const
+void HierarchyComponentT<T>::propagateChange(std::ptrdiff_t descendant_delta)
 {
-  // recursively count children
-  using function = std::function<size_t (const T&, size_t)>;
-  function recur = [&recur] (const T& handle, size_t count) {
-    count += handle.numChildren();
-    for (auto &child: handle.children())
-    {
-      count = recur(*child.get(), count);
-    }
-    return count;
-  };
+  auto *node = self();
+  node->_num_descendants += descendant_delta;
+  node->_hierarchy_changed = true;
+  while (node->_parent) {
+    node = node->_parent;
+    node->_num_descendants += descendant_delta;
+    node->_hierarchy_changed = true;
+  }
+}
+
+template <typename T>
+void HierarchyComponentT<T>::updateDepths(size_t depth)
+{
+  // Depths within the subtree are always consistent with each other, so there is nothing to do if this node is already right.
+  if (_depth == depth) {
+    return;
+  }
 
-  return recur(*self(), 0);
+  _depth = depth;
+  descend([] (const T &parent, T &child) {
+    child._depth = parent._depth + 1;
+  });
 }
 
 template <typename T>
 void HierarchyComponentT<T>::destroyChildren()
 {
-  for( auto &child : _children ) {
-    child->_parent = invalidHandle();
-    child->entity().destroy();
-  }
-  _children.clear();
+  destroyDescendants();
+  _children_changed = true;
+  propagateChange(- static_cast<std::ptrdiff_t>(_num_descendants));
 }
 
 template <typename T>
-void HierarchyComponentT<T>::descend( const std::function<void (const T&, T&)> &fn )
+void HierarchyComponentT<T>::destroySubtree()
 {
-  for( auto &c : _children ) {
-    fn( *self(), *c.get() );
-    c->descend( fn );
+  if( _parent ) {
+    _parent->removeChild( *this );
   }
+  destroyDescendants();
+  destroy();
 }
 
 template <typename T>
-void HierarchyComponentT<T>::ascend( const std::function<void (const T&, T&)> &fn )
+void HierarchyComponentT<T>::destroyDescendants()
 {
-  if( _parent ) {
-    fn( *self(), *_parent.get() );
-    _parent->ascend( fn );
+  if( ! _first_child ) {
+    return;
+  }
+
+  // Gather the subtree breadth-first, using the list itself as the queue.
+  std::vector<T*> nodes;
+  nodes.reserve( _num_descendants );
+  for( auto *child = _first_child; child; child = child->_next_sibling ) {
+    nodes.push_back( child );
+  }
+  for( size_t i = 0; i < nodes.size(); i += 1 ) {
+    for( auto *child = nodes[i]->_first_child; child; child = child->_next_sibling ) {
+      nodes.push_back( child );
+    }
+  }
+
+  std::vector<entityx::Entity> entities;
+  entities.reserve( nodes.size() );
+  for( auto *node : nodes ) {
+    entities.push_back( node->_entity );
+    node->_parent = nullptr;
+    node->_first_child = nullptr;
+    node->_last_child = nullptr;
+    node->_next_sibling = nullptr;
+    node->_previous_sibling = nullptr;
+    node->_num_children = 0;
+    node->_num_descendants = 0;
+  }
+  _first_child = nullptr;
+  _last_child = nullptr;
+  _num_children = 0;
+
+  // Leaves first. Other components' destructors may have destroyed some of these entities already.
+  for( auto iter = entities.rbegin(); iter != entities.rend(); ++iter ) {
+    if( iter->valid() ) {
+      iter->destroy();
+    }
   }
 }
 
+template <typename T>
+template <typename Fn>
+void HierarchyComponentT<T>::descend( Fn &&fn )
+{
+  descendUntil( [&fn] (const T &parent, T &child) {
+    fn( parent, child );
+    return false;
+  } );
+}
 
 template <typename T>
-void HierarchyComponentT<T>::descendUntil( const std::function<bool (const T&, T&)> &fn )
+template <typename Fn>
+void HierarchyComponentT<T>::ascend( Fn &&fn )
 {
-  for( auto &c : _children ) {
-    auto reached_end = fn( *self(), *c.get() );
-    if (! reached_end) {
-      c->descend( fn );
+  ascendUntil( [&fn] (const T &child, T &parent) {
+    fn( child, parent );
+    return false;
+  } );
+}
+
+template <typename T>
+template <typename Fn>
+void HierarchyComponentT<T>::descendUntil( Fn &&fn )
+{
+  // Preorder walk: down to the first child, across to the next sibling, or back up until a sibling is found.
+  auto *root = self();
+  auto *node = _first_child;
+  while( node )
+  {
+    auto reached_end = fn( *node->_parent, *node );
+    if( (! reached_end) && node->_first_child ) {
+      node = node->_first_child;
+      continue;
     }
+
+    while( node != root && ! node->_next_sibling ) {
+      node = node->_parent;
+    }
+    node = (node == root) ? nullptr : node->_next_sibling;
   }
 }
 
 template <typename T>
-void HierarchyComponentT<T>::ascendUntil( const std::function<bool (const T&, T&)> &fn )
+template <typename Fn>
+void HierarchyComponentT<T>::ascendUntil( Fn &&fn )
 {
-  if( _parent ) {
-    auto reached_end = fn( *self(), *_parent.get() );
-    if (! reached_end) {
-      _parent->ascend( fn );
+  auto *node = self();
+  while( node->_parent )
+  {
+    auto *parent = node->_parent;
+    auto reached_end = fn( *node, *parent );
+    if( reached_end ) {
+      break;
     }
+    node = parent;
   }
 }
 
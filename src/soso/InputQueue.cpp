@@ -0,0 +1,44 @@
+//
+//  InputQueue.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "InputQueue.h"
+#include "cinder/app/Window.h"
+
+using namespace soso;
+using namespace cinder;
+using namespace cinder::app;
+
+InputQueue::InputQueue( const WindowRef &window )
+{
+  auto mouse_move = [this] (MouseEvent &event) { push( Type::MouseMove, event ); };
+  auto mouse_down = [this] (MouseEvent &event) { push( Type::MouseDown, event ); };
+  auto mouse_drag = [this] (MouseEvent &event) { push( Type::MouseDrag, event ); };
+  auto mouse_up = [this] (MouseEvent &event) { push( Type::MouseUp, event ); };
+
+  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseMove().connect( mouse_move ) ) );
+  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseDown().connect( mouse_down ) ) );
+  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseDrag().connect( mouse_drag ) ) );
+  _signal_connections.emplace_back( std::make_shared<ci::signals::ScopedConnection>( window->getSignalMouseUp().connect( mouse_up ) ) );
+}
+
+void InputQueue::push( Type type, const MouseEvent &event )
+{
+  auto position = vec2( event.getPos() );
+  auto delta = _has_position ? position - _last_position : vec2( 0 );
+  _last_position = position;
+  _has_position = true;
+
+  auto coalesces = (type == Type::MouseMove || type == Type::MouseDrag);
+  if( coalesces && ! _inputs.empty() && _inputs.back().type == type ) {
+    auto &previous = _inputs.back();
+    previous.event = event;
+    previous.delta += delta;
+  }
+  else {
+    _inputs.push_back( MouseInput{ type, event, delta } );
+  }
+}
@@ -0,0 +1,78 @@
+//
+//  InputQueue.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include <vector>
+
+namespace soso {
+
+///
+/// Collects a window's mouse events between updates so a system can handle them once per frame.
+/// Consecutive moves (or drags) are coalesced into a single event at the latest position,
+/// with the movement they covered summed into its delta. Downs and ups are kept in order,
+/// so a press always sees the position it happened at.
+///
+class InputQueue
+{
+public:
+  enum class Type
+  {
+    MouseMove,
+    MouseDrag,
+    MouseDown,
+    MouseUp
+  };
+
+  struct MouseInput
+  {
+    Type                type;
+    ci::app::MouseEvent event;
+    /// Movement since the previous queued input, including every event coalesced into this one.
+    ci::vec2            delta;
+  };
+
+  /// Starts collecting mouse events from the given window.
+  explicit InputQueue( const ci::app::WindowRef &window );
+
+  InputQueue( const InputQueue & ) = delete;
+  InputQueue& operator=( const InputQueue & ) = delete;
+
+  /// Adds an event to the queue, merging it with the previous one if both are moves or both are drags.
+  void push( Type type, const ci::app::MouseEvent &event );
+
+  /// Calls fn with each queued input in order and empties the queue.
+  /// Inputs pushed while dispatching wait for the next call.
+  template <typename Fn>
+  void dispatch( const Fn &fn );
+
+  size_t size() const { return _inputs.size(); }
+  bool empty() const { return _inputs.empty(); }
+
+private:
+  using ScopedConnectionRef = std::shared_ptr<ci::signals::ScopedConnection>;
+  std::vector<ScopedConnectionRef> _signal_connections;
+  std::vector<MouseInput>          _inputs;
+  /// Storage for inputs being dispatched, reused between frames.
+  std::vector<MouseInput>          _dispatching;
+  ci::vec2                         _last_position;
+  bool                             _has_position = false;
+};
+
+#pragma mark - Template Implementation
+
+template <typename Fn>
+void InputQueue::dispatch( const Fn &fn )
+{
+  std::swap( _inputs, _dispatching );
+  for( auto &input : _dispatching ) {
+    fn( input );
+  }
+  _dispatching.clear();
+}
+
+} // namespace soso
@@ -0,0 +1,84 @@
+//
+//  SharedBehavior.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "SharedBehavior.h"
+#include "BehaviorStore.h"
+
+using namespace soso;
+using namespace entityx;
+
+void SharedBehavior::add( BehaviorStore &store, Entity entity )
+{
+  if( _updating ) {
+    _pending.emplace_back( entity, true );
+    return;
+  }
+
+  auto id = entity.id().id();
+  if( _indices.count( id ) ) {
+    return;
+  }
+
+  _indices[id] = _entities.size();
+  _entities.push_back( entity );
+  if( _entities.size() == 1 ) {
+    _store = &store;
+    store.addShared( shared_from_this() );
+  }
+}
+
+void SharedBehavior::remove( Entity entity )
+{
+  if( _updating ) {
+    _pending.emplace_back( entity, false );
+    return;
+  }
+
+  auto iter = _indices.find( entity.id().id() );
+  if( iter == _indices.end() ) {
+    return;
+  }
+
+  // Fill the gap with the last entity.
+  auto index = iter->second;
+  _indices.erase( iter );
+  if( index != _entities.size() - 1 ) {
+    _entities[index] = _entities.back();
+    _indices[_entities[index].id().id()] = index;
+  }
+  _entities.pop_back();
+
+  if( _entities.empty() ) {
+    // May release the last reference to us, so do nothing afterward.
+    _store->removeShared( this );
+  }
+}
+
+void SharedBehavior::applyPending()
+{
+  auto pending = std::move( _pending );
+  _pending.clear();
+  for( auto &change : pending ) {
+    if( change.second ) {
+      add( *_store, change.first );
+    }
+    else {
+      remove( change.first );
+    }
+  }
+}
+
+void SharedBehavior::runUpdate( TimeDelta dt )
+{
+  _updating = true;
+  update( entities(), dt );
+  _updating = false;
+
+  if( ! _pending.empty() ) {
+    applyPending();
+  }
+}
@@ -0,0 +1,88 @@
+//
+//  SharedBehavior.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "entityx/Entity.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace soso {
+
+class BehaviorStore;
+
+///
+/// A contiguous run of entities, passed to shared behaviors.
+///
+class EntitySpan
+{
+public:
+  EntitySpan( const entityx::Entity *begin, const entityx::Entity *end )
+  : _begin( begin ),
+    _end( end )
+  {}
+
+  const entityx::Entity* begin() const { return _begin; }
+  const entityx::Entity* end() const { return _end; }
+  size_t size() const { return _end - _begin; }
+  bool empty() const { return _begin == _end; }
+  entityx::Entity operator[]( size_t index ) const { return _begin[index]; }
+
+private:
+  const entityx::Entity *_begin;
+  const entityx::Entity *_end;
+};
+
+///
+/// A single behavior applied to many entities.
+/// Rather than being called once per entity, update is called once with every entity the behavior is applied to,
+/// so per-entity state belongs in components and the behavior holds only what its entities share.
+///
+/// Assign with assignBehavior( entity, shared_behavior ). The behavior stays alive while it is applied to any entity.
+///
+class SharedBehavior : public std::enable_shared_from_this<SharedBehavior>
+{
+public:
+  SharedBehavior() = default;
+  virtual ~SharedBehavior() = default;
+
+  SharedBehavior( const SharedBehavior & ) = delete;
+  SharedBehavior& operator=( const SharedBehavior & ) = delete;
+
+  /// Called once per BehaviorSystem update with every entity the behavior is applied to.
+  /// Entities added or removed during the call are added or removed once it returns;
+  /// entities destroyed during the call stay in the span but are no longer valid.
+  virtual void update( EntitySpan entities, entityx::TimeDelta dt ) = 0;
+
+  /// The entities this behavior is applied to, in no particular order.
+  EntitySpan entities() const { return EntitySpan( _entities.data(), _entities.data() + _entities.size() ); }
+  size_t numEntities() const { return _entities.size(); }
+
+private:
+  std::vector<entityx::Entity>          _entities;
+  /// Where each entity is in _entities, by id.
+  std::unordered_map<uint64_t, size_t>  _indices;
+  /// Membership changes requested during update. True to add, false to remove.
+  std::vector<std::pair<entityx::Entity, bool>> _pending;
+  bool                                  _updating = false;
+  BehaviorStore                         *_store = nullptr;
+
+  void add( BehaviorStore &store, entityx::Entity entity );
+  void remove( entityx::Entity entity );
+  void applyPending();
+  void runUpdate( entityx::TimeDelta dt );
+
+  friend class BehaviorStore;
+  friend struct BehaviorComponent;
+  friend void assignBehavior( entityx::Entity entity, const std::shared_ptr<SharedBehavior> &behavior );
+  friend void removeBehavior( entityx::Entity entity, const std::shared_ptr<SharedBehavior> &behavior );
+};
+
+using SharedBehaviorRef = std::shared_ptr<SharedBehavior>;
+
+} // namespace soso
@@ -0,0 +1,74 @@
+//
+//  SimdLanes.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include <cstddef>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+  #include <immintrin.h>
+  #define SOSO_SIMD_SSE 1
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+  #define SOSO_SIMD_NEON 1
+#endif
+
+namespace soso {
+namespace simd {
+
+///
+/// Thin wrappers over the widest float vector available, so kernels are only written once.
+/// Aligned loads and stores need addresses aligned to the full vector width.
+///
+#if defined(__AVX__)
+using Lanes = __m256;
+const size_t LaneCount = 8;
+inline Lanes load(const float *v) { return _mm256_load_ps(v); }
+inline void store(float *v, Lanes a) { _mm256_store_ps(v, a); }
+inline Lanes loadUnaligned(const float *v) { return _mm256_loadu_ps(v); }
+inline void storeUnaligned(float *v, Lanes a) { _mm256_storeu_ps(v, a); }
+inline Lanes splat(float s) { return _mm256_set1_ps(s); }
+inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+#elif defined(SOSO_SIMD_SSE)
+using Lanes = __m128;
+const size_t LaneCount = 4;
+inline Lanes load(const float *v) { return _mm_load_ps(v); }
+inline void store(float *v, Lanes a) { _mm_store_ps(v, a); }
+inline Lanes loadUnaligned(const float *v) { return _mm_loadu_ps(v); }
+inline void storeUnaligned(float *v, Lanes a) { _mm_storeu_ps(v, a); }
+inline Lanes splat(float s) { return _mm_set1_ps(s); }
+inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+#elif defined(SOSO_SIMD_NEON)
+using Lanes = float32x4_t;
+const size_t LaneCount = 4;
+inline Lanes load(const float *v) { return vld1q_f32(v); }
+inline void store(float *v, Lanes a) { vst1q_f32(v, a); }
+inline Lanes loadUnaligned(const float *v) { return vld1q_f32(v); }
+inline void storeUnaligned(float *v, Lanes a) { vst1q_f32(v, a); }
+inline Lanes splat(float s) { return vdupq_n_f32(s); }
+inline Lanes add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+inline Lanes sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+inline Lanes mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+#else
+using Lanes = float;
+const size_t LaneCount = 1;
+inline Lanes load(const float *v) { return *v; }
+inline void store(float *v, Lanes a) { *v = a; }
+inline Lanes loadUnaligned(const float *v) { return *v; }
+inline void storeUnaligned(float *v, Lanes a) { *v = a; }
+inline Lanes splat(float s) { return s; }
+inline Lanes add(Lanes a, Lanes b) { return a + b; }
+inline Lanes sub(Lanes a, Lanes b) { return a - b; }
+inline Lanes mul(Lanes a, Lanes b) { return a * b; }
+#endif
+
+} // namespace simd
+} // namespace soso
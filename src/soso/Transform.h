@@ -8,11 +8,14 @@
 #pragma once
 
 #include "HierarchyComponentT.h"
+#include "TransformKernels.h"
+#include <atomic>
 
 namespace soso {
 
 ///
 /// A hierarchical spatial transformation.
+/// Changes go through setters so TransformSystem only recomposes what moved.
 ///
 struct Transform : public HierarchyComponentT<Transform>
 {
@@ -20,34 +23,121 @@ struct Transform : public HierarchyComponentT<Transform>
   using HierarchyComponentT<Transform>::HierarchyComponentT;
   Transform(entityx::Entity entity, const ci::vec3 &position, const ci::vec3 &scale = ci::vec3(1), const ci::vec3 &pivot = ci::vec3(0), const ci::quat &orientation = ci::quat() )
   : HierarchyComponentT(entity),
-    position(position),
-    scale(scale),
-    pivot(pivot),
-    orientation(orientation)
+    _position(position),
+    _scale(scale),
+    _pivot(pivot),
+    _orientation(orientation)
   {}
 
-  ci::vec3  position = ci::vec3(0);
-  ci::vec3  scale = ci::vec3(1);
-  ci::vec3  pivot = ci::vec3(0); // relative center of orientation and scaling.
-  ci::quat  orientation;
+  const ci::vec3& position() const { return _position; }
+  const ci::vec3& scale() const { return _scale; }
+  /// Relative center of orientation and scaling.
+  const ci::vec3& pivot() const { return _pivot; }
+  const ci::quat& orientation() const { return _orientation; }
 
-  const ci::mat4& worldTransform() const { return _world_transform; }
-  const ci::mat4& localTransform() const { return _local_transform; }
-  ci::vec3 worldPoint() const { return ci::vec3(worldTransform() *  ci::vec4(0, 0, 0, 1)); }
+  void setPosition(const ci::vec3 &position) { _position = position; markDirty(); }
+  void setScale(const ci::vec3 &scale) { _scale = scale; markDirty(); }
+  void setPivot(const ci::vec3 &pivot) { _pivot = pivot; markDirty(); }
+  void setOrientation(const ci::quat &orientation) { _orientation = orientation; markDirty(); }
+
+  const AffineTransform& worldAffine() const { return _world_transform; }
+  const AffineTransform& localAffine() const { return _local_transform; }
+  /// Full 4x4 matrices, for handing to the renderer.
+  ci::mat4 worldTransform() const { return _world_transform.toMat4(); }
+  ci::mat4 localTransform() const { return _local_transform.toMat4(); }
+  ci::vec3 worldPoint() const { return _world_transform.translation(); }
 
   /// Compose a transform into this transform's world transform.
-  void composeTransform(const ci::mat4 &transform) {
-    _local_transform = calcLocalTransform();
-    _world_transform = transform * _local_transform;
+  /// The local transform is only recalculated if it changed since the last composition.
+  void composeTransform(const AffineTransform &transform) {
+    if (_local_dirty) {
+      auto self = this;
+      updateLocalTransforms(&self, 1);
+    }
+    composeTransforms(transform, _local_transform, &_world_transform);
   }
 
-  ci::mat4 calcLocalTransform() const { return glm::translate(position + pivot) * glm::toMat4(orientation) * glm::scale(scale) * glm::translate(- pivot / scale); }
+  /// Recalculate the local transforms of many transforms at once, using a SIMD kernel.
+  static void updateLocalTransforms(Transform *const *transforms, size_t count);
+
+  /// Returns true if this transform's local values changed since it was last composed.
+  bool localDirty() const { return _local_dirty; }
+  /// Returns true if any descendant's local values changed since the last update.
+  bool descendantsDirty() const { return _descendants_dirty.get(); }
+  void clearDescendantsDirty() { _descendants_dirty.set(false); }
 
 private:
-  ci::mat4  _world_transform;
-  ci::mat4  _local_transform;
+  ci::vec3  _position = ci::vec3(0);
+  ci::vec3  _scale = ci::vec3(1);
+  ci::vec3  _pivot = ci::vec3(0);
+  ci::quat  _orientation;
+
+  AffineTransform _world_transform;
+  AffineTransform _local_transform;
+
+  /// A flag that can be set from several threads at once, but still copies and moves with its Transform.
+  /// The flag is only read once the parallel update that sets it has joined, so relaxed ordering is enough.
+  class SharedFlag
+  {
+  public:
+    SharedFlag() = default;
+    SharedFlag(const SharedFlag &other) : _value(other.get()) {}
+    SharedFlag& operator=(const SharedFlag &other) { set(other.get()); return *this; }
+
+    bool get() const { return _value.load(std::memory_order_relaxed); }
+    void set(bool value) { _value.store(value, std::memory_order_relaxed); }
+  private:
+    std::atomic<bool> _value{ false };
+  };
+
+  bool      _local_dirty = true;
+  /// Shared since behaviors updating in parallel may flag a common ancestor at the same time.
+  SharedFlag _descendants_dirty;
+
+  /// Flags this transform for recomposition and lets its ancestors know there is work below them.
+  void markDirty();
+
+  /// Marks branches whose children changed, so they are composed under their new shape.
+  friend class TransformSystem;
 };
 
+inline void Transform::updateLocalTransforms(Transform *const *transforms, size_t count)
+{
+  // Gather blocks of transforms into structure-of-arrays form for the kernel.
+  LocalTransformBlock block = {};
+  AffineTransform *outputs[LocalTransformBlock::Size];
+
+  for (size_t begin = 0; begin < count; begin += LocalTransformBlock::Size) {
+    size_t block_size = std::min<size_t>(count - begin, +LocalTransformBlock::Size);
+    for (size_t i = 0; i < block_size; i += 1) {
+      auto &xf = *transforms[begin + i];
+      for (int c = 0; c < 3; c += 1) {
+        block.position[c][i] = xf._position[c];
+        block.scale[c][i] = xf._scale[c];
+        block.pivot[c][i] = xf._pivot[c];
+      }
+      block.orientation[0][i] = xf._orientation.x;
+      block.orientation[1][i] = xf._orientation.y;
+      block.orientation[2][i] = xf._orientation.z;
+      block.orientation[3][i] = xf._orientation.w;
+      outputs[i] = &xf._local_transform;
+      xf._local_dirty = false;
+    }
+    calcLocalTransforms(block, block_size, outputs);
+  }
+}
+
+inline void Transform::markDirty()
+{
+  _local_dirty = true;
+  // Ancestors above one that is already flagged were flagged along with it.
+  auto ancestor = parent();
+  while (ancestor && ! ancestor->_descendants_dirty.get()) {
+    ancestor->_descendants_dirty.set(true);
+    ancestor = ancestor->parent();
+  }
+}
+
 #pragma mark - Free functions for creating hierarchies.
 
 /// Make a hierarchy component for an entity.
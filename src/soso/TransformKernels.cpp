@@ -0,0 +1,112 @@
+//
+//  TransformKernels.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "TransformKernels.h"
+#include "SimdLanes.h"
+
+using namespace soso;
+using namespace cinder;
+using namespace soso::simd;
+
+namespace {
+
+/// Matrix elements for a block of transforms, one row per element of the upper 3x4 of each matrix.
+struct MatrixBlock
+{
+  alignas(32) float columns[4][3][LocalTransformBlock::Size];
+};
+
+/// Computes LaneCount local matrices starting at lane \a offset of the block.
+inline void calcLanes( const LocalTransformBlock &in, size_t offset, MatrixBlock &out )
+{
+  const auto one = splat( 1.0f );
+  const auto two = splat( 2.0f );
+
+  auto x = load( &in.orientation[0][offset] );
+  auto y = load( &in.orientation[1][offset] );
+  auto z = load( &in.orientation[2][offset] );
+  auto w = load( &in.orientation[3][offset] );
+
+  auto xx = mul( x, x ), yy = mul( y, y ), zz = mul( z, z );
+  auto xy = mul( x, y ), xz = mul( x, z ), yz = mul( y, z );
+  auto wx = mul( w, x ), wy = mul( w, y ), wz = mul( w, z );
+
+  // Rotation matrix columns, as in glm::toMat3.
+  Lanes r[3][3] = {
+    { sub( one, mul( two, add( yy, zz ) ) ), mul( two, add( xy, wz ) ), mul( two, sub( xz, wy ) ) },
+    { mul( two, sub( xy, wz ) ), sub( one, mul( two, add( xx, zz ) ) ), mul( two, add( yz, wx ) ) },
+    { mul( two, add( xz, wy ) ), mul( two, sub( yz, wx ) ), sub( one, mul( two, add( xx, yy ) ) ) }
+  };
+
+  // Scaled rotation columns.
+  for( int c = 0; c < 3; c += 1 ) {
+    auto s = load( &in.scale[c][offset] );
+    for( int row = 0; row < 3; row += 1 ) {
+      store( &out.columns[c][row][offset], mul( r[c][row], s ) );
+    }
+  }
+
+  // Rotating and scaling about the pivot leaves the translation at position + pivot - rotate(pivot).
+  auto px = load( &in.pivot[0][offset] );
+  auto py = load( &in.pivot[1][offset] );
+  auto pz = load( &in.pivot[2][offset] );
+  for( int row = 0; row < 3; row += 1 ) {
+    auto rotated = add( add( mul( r[0][row], px ), mul( r[1][row], py ) ), mul( r[2][row], pz ) );
+    auto pivot = load( &in.pivot[row][offset] );
+    auto position = load( &in.position[row][offset] );
+    store( &out.columns[3][row][offset], sub( add( position, pivot ), rotated ) );
+  }
+}
+
+} // namespace
+
+void soso::calcLocalTransforms( const LocalTransformBlock &block, size_t count, AffineTransform *const *out )
+{
+  MatrixBlock matrices;
+  for( size_t offset = 0; offset < count; offset += LaneCount ) {
+    calcLanes( block, offset, matrices );
+  }
+
+  // Scatter back into row-major affine transforms.
+  for( size_t i = 0; i < count; i += 1 ) {
+    auto &m = *out[i];
+    for( int row = 0; row < 3; row += 1 ) {
+      m.rows[row] = vec4( matrices.columns[0][row][i], matrices.columns[1][row][i], matrices.columns[2][row][i], matrices.columns[3][row][i] );
+    }
+  }
+}
+
+void soso::composeTransforms( const AffineTransform &parent, const AffineTransform &local, AffineTransform *out )
+{
+  // Each output row is a combination of the local rows, weighted by the parent row.
+  // The implied bottom row of local only contributes the parent's translation.
+#if defined(SOSO_SIMD_SSE)
+  auto l0 = _mm_loadu_ps( &local.rows[0][0] );
+  auto l1 = _mm_loadu_ps( &local.rows[1][0] );
+  auto l2 = _mm_loadu_ps( &local.rows[2][0] );
+  for( int row = 0; row < 3; row += 1 ) {
+    auto &p = parent.rows[row];
+    auto result = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( l0, _mm_set1_ps( p[0] ) ), _mm_mul_ps( l1, _mm_set1_ps( p[1] ) ) ), _mm_mul_ps( l2, _mm_set1_ps( p[2] ) ) ), _mm_setr_ps( 0, 0, 0, p[3] ) );
+    _mm_storeu_ps( &out->rows[row][0], result );
+  }
+#elif defined(SOSO_SIMD_NEON)
+  auto l0 = vld1q_f32( &local.rows[0][0] );
+  auto l1 = vld1q_f32( &local.rows[1][0] );
+  auto l2 = vld1q_f32( &local.rows[2][0] );
+  for( int row = 0; row < 3; row += 1 ) {
+    auto &p = parent.rows[row];
+    auto translation = vsetq_lane_f32( p[3], vdupq_n_f32( 0 ), 3 );
+    auto result = vaddq_f32( vaddq_f32( vaddq_f32( vmulq_n_f32( l0, p[0] ), vmulq_n_f32( l1, p[1] ) ), vmulq_n_f32( l2, p[2] ) ), translation );
+    vst1q_f32( &out->rows[row][0], result );
+  }
+#else
+  for( int row = 0; row < 3; row += 1 ) {
+    auto &p = parent.rows[row];
+    out->rows[row] = ((local.rows[0] * p[0] + local.rows[1] * p[1]) + local.rows[2] * p[2]) + vec4( 0, 0, 0, p[3] );
+  }
+#endif
+}
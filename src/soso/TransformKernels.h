@@ -0,0 +1,37 @@
+//
+//  TransformKernels.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "AffineTransform.h"
+
+namespace soso {
+
+///
+/// Local transform inputs for a block of transforms, laid out as structure-of-arrays.
+/// Each attribute component is stored in its own row so a SIMD register can load the same component for several transforms.
+///
+struct LocalTransformBlock
+{
+  static const size_t Size = 8;
+
+  alignas(32) float position[3][Size];
+  alignas(32) float scale[3][Size];
+  alignas(32) float pivot[3][Size];
+  /// Quaternion components in x, y, z, w order.
+  alignas(32) float orientation[4][Size];
+};
+
+/// Calculates translate(position + pivot) * rotate(orientation) * scale(scale) * translate(-pivot / scale)
+/// for the first \a count transforms in a block, 4 or 8 at a time depending on the available instruction set.
+/// Writes each result to the matching pointer in \a out.
+void calcLocalTransforms( const LocalTransformBlock &block, size_t count, AffineTransform *const *out );
+
+/// Multiplies two affine transforms, parent * local, with SIMD instructions where available.
+void composeTransforms( const AffineTransform &parent, const AffineTransform &local, AffineTransform *out );
+
+} // namespace soso
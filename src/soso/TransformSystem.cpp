@@ -6,29 +6,406 @@
 //
 
 #include "TransformSystem.h"
-#include "HierarchyComponent.h"
 #include "Transform.h"
+#include "WorkerPool.h"
 
 using namespace entityx;
 using namespace cinder;
 using namespace soso;
 
-void TransformSystem::update(EntityManager &entities, EventManager &events, TimeDelta dt)
+namespace {
+
+/// Branches with more nodes than this are split up between workers.
+const size_t MaxBranchSize = 1024;
+
+/// Parent transform for roots.
+const AffineTransform IdentityTransform = AffineTransform();
+
+} // namespace
+
+void TransformSystem::configure( EventManager &events )
+{
+  events.subscribe<ComponentAddedEvent<Transform>>( *this );
+}
+
+void TransformSystem::receive( const ComponentAddedEvent<Transform> &event )
+{
+  _created.push_back( event.component );
+}
+
+void TransformSystem::update( EntityManager &entities, EventManager &events, TimeDelta dt )
+{
+  _step += 1;
+  if( _step == 0 ) {
+    _step = 1;
+  }
+
+  if( _needs_full_scan ) {
+    ComponentHandle<Transform> transform;
+    for( auto __unused e : entities.entities_with_components( transform ) ) {
+      _created.push_back( transform );
+    }
+    _needs_full_scan = false;
+  }
+
+  for( auto &handle : _created ) {
+    if( handle && handle->isRoot() ) {
+      _new_roots.push_back( handle );
+    }
+  }
+  _created.clear();
+
+  // Bring the flattened order up to date with any structural changes.
+  // Hierarchies whose root was destroyed or parented elsewhere are dropped; their surviving branches become new roots.
+  auto end = std::remove_if( _hierarchies.begin(), _hierarchies.end(), [this] (FlatHierarchy &hierarchy) {
+    if( (! hierarchy.root) || (! hierarchy.root->isRoot()) ) {
+      collectDetachedRoots( hierarchy, 0, hierarchy.handles.size() );
+      return true;
+    }
+
+    if( hierarchy.root->hierarchyChanged() ) {
+      refreshHierarchy( hierarchy );
+    }
+    return false;
+  } );
+  _hierarchies.erase( end, _hierarchies.end() );
+  addNewRoots();
+
+  if( _previous_world_unsized ) {
+    for( auto &hierarchy : _hierarchies ) {
+      reservePreviousWorld( hierarchy.nodes );
+    }
+    _previous_world_unsized = false;
+  }
+
+  if( _parallel )
+  {
+    if( ! _worker_pool ) {
+      _worker_pool = std::make_shared<WorkerPool>();
+    }
+
+    // Each hierarchy is independent; large ones are split into branches below their first few levels.
+    _branches.clear();
+    for( auto &hierarchy : _hierarchies ) {
+      splitHierarchy( hierarchy );
+    }
+    _worker_pool->parallelFor( _branches.size(), [this] (size_t i) {
+      auto &branch = _branches[i];
+      compose( *branch.hierarchy, branch.begin, branch.end );
+    } );
+  }
+  else
+  {
+    for( auto &hierarchy : _hierarchies ) {
+      compose( hierarchy, 0, hierarchy.nodes.size() );
+    }
+  }
+
+  for( auto &hierarchy : _hierarchies ) {
+    hierarchy.recompose_all = false;
+  }
+}
+
+bool TransformSystem::visitNode( FlatHierarchy &hierarchy, size_t index )
 {
-  ComponentHandle<Transform> transform;
+  auto &nodes = hierarchy.nodes;
+  auto &node = nodes[index];
+  auto &xf = *node.transform;
+  auto parent_changed = (index != 0) && nodes[node.parent].world_changed;
+
+  node.world_changed = hierarchy.recompose_all || parent_changed || xf.localDirty();
+  if( (! node.world_changed) && (! xf.descendantsDirty()) ) {
+    // Nothing moved in this subtree.
+    return false;
+  }
+
+  xf.clearDescendantsDirty();
+  return true;
+}
 
-  /// If/when entityx allows us to order our components in memory based on their hierarchy,
-  /// we will be able to walk through and simply update in linear order.
-  /// We could also do that if we wrote our own memory allocator for transforms (which we are unlikely to pursue).
+void TransformSystem::composeNode( FlatHierarchy &hierarchy, size_t index )
+{
+  auto &nodes = hierarchy.nodes;
+  auto &node = nodes[index];
+  auto &parent = (index == 0) ? IdentityTransform : nodes[node.parent].transform->worldAffine();
+  if( ! _interpolated ) {
+    node.transform->composeTransform( parent );
+    return;
+  }
+
+  // The first composition in each update keeps the world transform from before it.
+  // Transforms we haven't seen before start out with no motion to interpolate.
+  auto &xf = *node.transform;
+  auto id = xf.entity().id();
+  auto &previous = _previous_world[id.index()];
+  auto first_composition = (previous.id != id);
+  if( (! first_composition) && previous.step != _step ) {
+    previous.transform = xf.worldAffine();
+  }
+  xf.composeTransform( parent );
+  if( first_composition ) {
+    previous.transform = xf.worldAffine();
+    previous.id = id;
+  }
+  previous.step = _step;
+}
+
+void TransformSystem::compose( FlatHierarchy &hierarchy, size_t begin, size_t end )
+{
+  // Scratch space per thread, since branches may be composed in parallel.
+  thread_local std::vector<size_t>      changed;
+  thread_local std::vector<Transform*>  dirty_locals;
+  changed.clear();
+  dirty_locals.clear();
 
-  for (Entity __unused e : entities.entities_with_components(transform))
+  // Find what moved. This only depends on dirty flags, so no matrices are touched yet.
+  auto &nodes = hierarchy.nodes;
+  auto i = begin;
+  while( i < end )
   {
-    if (transform->isRoot())
-    {
-      transform->composeTransform(mat4(1));
-      transform->descend([] (const Transform &parent, Transform &child) {
-        child.composeTransform(parent.worldTransform());
-      });
+    if( visitNode( hierarchy, i ) ) {
+      if( nodes[i].world_changed ) {
+        changed.push_back( i );
+        if( nodes[i].transform->localDirty() ) {
+          dirty_locals.push_back( nodes[i].transform );
+        }
+      }
+      i += 1;
+    }
+    else {
+      i = nodes[i].end;
+    }
+  }
+
+  Transform::updateLocalTransforms( dirty_locals.data(), dirty_locals.size() );
+
+  // Parents always precede their children, so a single forward pass composes every world transform.
+  for( auto index : changed ) {
+    composeNode( hierarchy, index );
+  }
+}
+
+void TransformSystem::splitHierarchy( FlatHierarchy &hierarchy )
+{
+  auto &nodes = hierarchy.nodes;
+  _split_stack.push_back( 0 );
+  while( ! _split_stack.empty() )
+  {
+    auto index = _split_stack.back();
+    auto end = nodes[index].end;
+    _split_stack.pop_back();
+
+    if( end - index <= MaxBranchSize ) {
+      // Only bother a worker if something in the branch needs composing.
+      auto &xf = *nodes[index].transform;
+      auto parent_changed = (index != 0) && nodes[nodes[index].parent].world_changed;
+      if( hierarchy.recompose_all || parent_changed || xf.localDirty() || xf.descendantsDirty() ) {
+        _branches.push_back( Branch{ &hierarchy, index, end } );
+      }
+    }
+    else if( visitNode( hierarchy, index ) ) {
+      // Compose the top of a large branch here; its children's branches are independent of each other.
+      if( nodes[index].world_changed ) {
+        composeNode( hierarchy, index );
+      }
+      for( auto child = index + 1; child < end; child = nodes[child].end ) {
+        _split_stack.push_back( child );
+      }
+    }
+  }
+}
+
+void TransformSystem::setInterpolated( bool interpolated )
+{
+  if( interpolated && ! _interpolated ) {
+    _previous_world_unsized = true;
+  }
+  else if( ! interpolated ) {
+    std::vector<PreviousWorld>().swap( _previous_world );
+    _previous_world_unsized = false;
+  }
+  _interpolated = interpolated;
+}
+
+void TransformSystem::reservePreviousWorld( const std::vector<Node> &nodes )
+{
+  size_t size = _previous_world.size();
+  for( auto &node : nodes ) {
+    size = std::max<size_t>( size, node.transform->entity().id().index() + 1 );
+  }
+  _previous_world.resize( size );
+}
+
+AffineTransform TransformSystem::interpolatedWorldAffine( const Transform &transform, float alpha ) const
+{
+  if( ! _interpolated ) {
+    return transform.worldAffine();
+  }
+
+  // Transforms that didn't move during the latest update are already where they should be.
+  auto id = transform.entity().id();
+  if( id.index() >= _previous_world.size() ) {
+    return transform.worldAffine();
+  }
+  auto &previous = _previous_world[id.index()];
+  if( previous.id != id || previous.step != _step ) {
+    return transform.worldAffine();
+  }
+  return interpolate( previous.transform, transform.worldAffine(), alpha );
+}
+
+mat4 TransformSystem::interpolatedWorldTransform( const Transform &transform, float alpha ) const
+{
+  return interpolatedWorldAffine( transform, alpha ).toMat4();
+}
+
+void TransformSystem::flatten( FlatHierarchy &hierarchy )
+{
+  flattenBranch( hierarchy.root.get(), 0, 0, hierarchy.nodes, hierarchy.handles );
+  hierarchy.recompose_all = true;
+  if( _interpolated ) {
+    reservePreviousWorld( hierarchy.nodes );
+  }
+}
+
+void TransformSystem::flattenBranch( Transform *branch, size_t parent, size_t begin, std::vector<Node> &nodes, std::vector<TransformHandle> &handles )
+{
+  nodes.clear();
+  handles.clear();
+
+  // Depth-first, following child and sibling links. Each node's range is closed once we climb back out of it.
+  auto *xf = branch;
+  nodes.reserve( branch->numDescendants() + 1 );
+  handles.reserve( branch->numDescendants() + 1 );
+  while( true )
+  {
+    auto index = begin + nodes.size();
+    nodes.push_back( Node{ xf, parent, index + 1, false } );
+    handles.push_back( xf->handle() );
+    xf->clearHierarchyChanged();
+    xf->clearChildrenChanged();
+
+    if( xf->firstChild() ) {
+      parent = index;
+      xf = xf->firstChild();
+      continue;
+    }
+
+    while( xf != branch && ! xf->nextSibling() ) {
+      xf = xf->parent();
+      nodes[parent - begin].end = begin + nodes.size();
+      parent = nodes[parent - begin].parent;
+    }
+    if( xf == branch ) {
+      break;
+    }
+    xf = xf->nextSibling();
+  }
+}
+
+void TransformSystem::refreshHierarchy( FlatHierarchy &hierarchy )
+{
+  // Every ancestor of a change is flagged, so unflagged branches can be skipped without looking inside them.
+  // Nodes whose own children changed are re-flattened along with everything below them.
+  auto &nodes = hierarchy.nodes;
+  size_t i = 0;
+  while( i < nodes.size() )
+  {
+    auto &xf = *nodes[i].transform;
+    if( xf.childrenChanged() ) {
+      i = reflattenBranch( hierarchy, i );
+    }
+    else if( xf.hierarchyChanged() ) {
+      xf.clearHierarchyChanged();
+      i += 1;
+    }
+    else {
+      i = nodes[i].end;
+    }
+  }
+}
+
+size_t TransformSystem::reflattenBranch( FlatHierarchy &hierarchy, size_t begin )
+{
+  auto &nodes = hierarchy.nodes;
+  auto &handles = hierarchy.handles;
+  auto end = nodes[begin].end;
+  auto parent = nodes[begin].parent;
+
+  // Nodes that left the branch may have been detached; the rest are found again below.
+  collectDetachedRoots( hierarchy, begin, end );
+  flattenBranch( nodes[begin].transform, parent, begin, _branch_nodes, _branch_handles );
+  if( _interpolated ) {
+    reservePreviousWorld( _branch_nodes );
+  }
+
+  nodes.erase( nodes.begin() + begin, nodes.begin() + end );
+  nodes.insert( nodes.begin() + begin, _branch_nodes.begin(), _branch_nodes.end() );
+  handles.erase( handles.begin() + begin, handles.begin() + end );
+  handles.insert( handles.begin() + begin, _branch_handles.begin(), _branch_handles.end() );
+
+  auto branch_end = begin + _branch_nodes.size();
+  if( branch_end != end )
+  {
+    // Unsigned wraparound lets the same shift move indices either way.
+    auto delta = branch_end - end;
+    // The branch's ancestors grow or shrink with it. The root has no ancestors.
+    if( begin != 0 ) {
+      auto ancestor = parent;
+      nodes[ancestor].end += delta;
+      while( ancestor != 0 ) {
+        ancestor = nodes[ancestor].parent;
+        nodes[ancestor].end += delta;
+      }
+    }
+    // Nodes after the branch move along with it. None of them are parented inside it.
+    for( auto i = branch_end; i < nodes.size(); i += 1 ) {
+      nodes[i].end += delta;
+      if( nodes[i].parent >= end ) {
+        nodes[i].parent += delta;
+      }
+    }
+  }
+
+  // New children need composing under their new parent.
+  nodes[begin].transform->markDirty();
+  return branch_end;
+}
+
+void TransformSystem::collectDetachedRoots( const FlatHierarchy &hierarchy, size_t begin, size_t end )
+{
+  for( auto i = begin; i < end; i += 1 ) {
+    auto &handle = hierarchy.handles[i];
+    if( handle && handle->isRoot() && handle != hierarchy.root ) {
+      _new_roots.push_back( handle );
+    }
+  }
+}
+
+void TransformSystem::addNewRoots()
+{
+  if( _new_roots.empty() ) {
+    return;
+  }
+
+  // The same root may be found more than once (e.g. if its component was replaced), so only add each root once.
+  auto id_less = [] (TransformHandle &lhs, TransformHandle &rhs) { return lhs.entity().id() < rhs.entity().id(); };
+  auto id_equal = [] (TransformHandle &lhs, TransformHandle &rhs) { return lhs.entity().id() == rhs.entity().id(); };
+  std::sort( _new_roots.begin(), _new_roots.end(), id_less );
+  _new_roots.erase( std::unique( _new_roots.begin(), _new_roots.end(), id_equal ), _new_roots.end() );
+
+  std::vector<Entity::Id> existing;
+  existing.reserve( _hierarchies.size() );
+  for( auto &hierarchy : _hierarchies ) {
+    existing.push_back( hierarchy.root.entity().id() );
+  }
+  std::sort( existing.begin(), existing.end() );
+
+  for( auto &root : _new_roots ) {
+    if( ! std::binary_search( existing.begin(), existing.end(), root.entity().id() ) ) {
+      _hierarchies.emplace_back( root );
+      flatten( _hierarchies.back() );
     }
   }
+  _new_roots.clear();
 }
@@ -8,17 +8,147 @@
 #pragma once
 
 #include "entityx/System.h"
+#include "AffineTransform.h"
 
 namespace soso {
 
+struct Transform;
+class WorkerPool;
+
 /// Applies nested transformations and calculates transform matrices.
-class TransformSystem : public entityx::System<TransformSystem>
+///
+/// Each hierarchy is kept flattened in parent-before-child order, so world matrices are computed
+/// by walking a linear array instead of recursing through the scene graph.
+/// When a hierarchy's shape changes, only the branches whose children changed are re-flattened and spliced back into its order.
+/// Subtrees where nothing moved are skipped, so the cost of an update scales with what changed.
+///
+/// Independent hierarchies (and large subtrees within them) can optionally be composed on worker threads.
+/// The parallel update performs exactly the same operations per node, so its results match the serial update.
+class TransformSystem : public entityx::System<TransformSystem>, public entityx::Receiver<TransformSystem>
 {
 public:
+  void configure( entityx::EventManager &events ) override;
   void update( entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt ) override;
 
+  void receive( const entityx::ComponentAddedEvent<Transform> &event );
+
+  /// Switch between composing hierarchies on the calling thread or across a pool of worker threads.
+  void setParallel( bool parallel ) { _parallel = parallel; }
+  bool isParallel() const { return _parallel; }
+  /// Use a specific pool for parallel updates, e.g. to share worker threads between systems.
+  /// If none is provided, one is created the first time a parallel update runs.
+  void setWorkerPool( const std::shared_ptr<WorkerPool> &pool ) { _worker_pool = pool; }
+
+  /// Keep each transform's world state from before the latest update, so rendering can interpolate between updates.
+  /// Lets the simulation run at a lower fixed rate than the display.
+  /// The previous states are kept by the system, and only while interpolating.
+  void setInterpolated( bool interpolated );
+  bool isInterpolated() const { return _interpolated; }
+  /// Returns a transform's world transform blended from before the latest update (alpha = 0) towards its latest state (alpha = 1).
+  /// Typically alpha is the fraction of a fixed step accumulated since the latest update.
+  AffineTransform interpolatedWorldAffine( const Transform &transform, float alpha ) const;
+  ci::mat4        interpolatedWorldTransform( const Transform &transform, float alpha ) const;
+
 private:
+  using TransformHandle = entityx::ComponentHandle<Transform>;
+
+  /// A transform and the index of its parent within the same flattened hierarchy.
+  struct Node
+  {
+    Transform *transform;
+    size_t    parent;
+    /// One past the index of this node's last descendant.
+    size_t    end;
+    /// True if this node's world transform was recomposed during the current update.
+    bool      world_changed;
+  };
+
+  /// A root and all of its descendants, ordered so parents always precede their children.
+  struct FlatHierarchy
+  {
+    explicit FlatHierarchy( const TransformHandle &root )
+    : root( root )
+    {}
+
+    TransformHandle               root;
+    std::vector<Node>             nodes;
+    /// Handles to the nodes, used to find branches that were detached or destroyed since flattening.
+    std::vector<TransformHandle>  handles;
+    /// Set when the whole hierarchy was flattened, since none of its nodes have been composed yet.
+    bool                          recompose_all = true;
+  };
+
+  std::vector<FlatHierarchy>    _hierarchies;
+  /// Transforms created since the last update. Every new transform starts out as a root.
+  std::vector<TransformHandle>  _created;
+  /// Roots discovered during an update that don't have a flattened hierarchy yet.
+  std::vector<TransformHandle>  _new_roots;
+  /// Pick up any transforms that existed before we were configured.
+  bool                          _needs_full_scan = true;
+
+  /// A contiguous run of nodes in one hierarchy: a node and all of its descendants.
+  /// The parent of the first node has already been composed.
+  struct Branch
+  {
+    FlatHierarchy *hierarchy;
+    size_t        begin;
+    size_t        end;
+  };
+
+  /// A transform's world transform from before the latest update that moved it.
+  struct PreviousWorld
+  {
+    AffineTransform transform;
+    /// The transform's entity, so a reused entity index isn't mistaken for the entity that used to have it.
+    entityx::Entity::Id id;
+    /// The update during which the transform last moved.
+    uint32_t        step = 0;
+  };
+
+  bool                          _interpolated = false;
+  /// Counts updates, so we can tell whether transforms moved during the latest one. Never 0.
+  uint32_t                      _step = 0;
+  /// Previous world transforms by entity index. Only kept while interpolating.
+  /// Sized up front whenever hierarchies are flattened, so nodes composed in parallel never grow it.
+  std::vector<PreviousWorld>    _previous_world;
+  /// Set when interpolation is switched on, so existing hierarchies get room in _previous_world.
+  bool                          _previous_world_unsized = false;
+
+  bool                          _parallel = false;
+  std::shared_ptr<WorkerPool>   _worker_pool;
+  /// Branches to compose in parallel this update.
+  std::vector<Branch>           _branches;
+  /// Scratch space for splitting hierarchies into branches.
+  std::vector<size_t>           _split_stack;
+  /// Scratch space for re-flattening branches before they are spliced into their hierarchy.
+  std::vector<Node>             _branch_nodes;
+  std::vector<TransformHandle>  _branch_handles;
 
+  /// Build the flattened order of a new hierarchy from its root.
+  void flatten( FlatHierarchy &hierarchy );
+  /// Fill nodes and handles with the flattened order of a branch, numbered as if it started at index \a begin under \a parent.
+  /// Clears the hierarchy flags of every node in the branch.
+  void flattenBranch( Transform *branch, size_t parent, size_t begin, std::vector<Node> &nodes, std::vector<TransformHandle> &handles );
+  /// Bring a flattened hierarchy up to date with changes to its shape, skipping the branches that didn't change.
+  void refreshHierarchy( FlatHierarchy &hierarchy );
+  /// Re-flatten the branch starting at \a begin, splice it into its hierarchy and shift the nodes around it to match.
+  /// Returns the index just past the branch.
+  size_t reflattenBranch( FlatHierarchy &hierarchy, size_t begin );
+  /// Recompose the world transforms of any nodes in [begin, end) that moved.
+  /// Dirty local transforms are recalculated together in SIMD batches before world transforms are composed.
+  void compose( FlatHierarchy &hierarchy, size_t begin, size_t end );
+  /// Work out whether a node's world transform needs composing. Returns false if the node and everything below it can be skipped.
+  bool visitNode( FlatHierarchy &hierarchy, size_t index );
+  /// Compose a single node's world transform from its parent's.
+  void composeNode( FlatHierarchy &hierarchy, size_t index );
+  /// Make room in _previous_world for every node in a hierarchy or branch.
+  void reservePreviousWorld( const std::vector<Node> &nodes );
+  /// Compose the tops of large branches until what remains is small enough to hand to a worker.
+  void splitHierarchy( FlatHierarchy &hierarchy );
+  /// Queue up any previously flattened nodes in [begin, end) that have since become roots.
+  void collectDetachedRoots( const FlatHierarchy &hierarchy, size_t begin, size_t end );
+  /// Create flattened hierarchies for roots found this update.
+  void addNewRoots();
 };
 
 } // namespace soso
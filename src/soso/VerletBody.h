@@ -8,53 +8,161 @@
 #pragma once
 
 #include "entityx/Entity.h"
+#include "VerletBodyStore.h"
+#include <cassert>
+#include <memory>
 
 namespace soso {
 
 /// A point-mass for verlet simulation.
+/// Its state lives in the VerletPhysicsSystem's store, so add and configure the system before assigning bodies.
 struct VerletBody
 {
 
 VerletBody() = default;
 VerletBody(const ci::vec3 &position, float drag = 0.1f)
-: position( position ),
-  previous_position( position ),
-  drag( drag )
+: _initial{ position, position, drag }
 {}
 
+/// Copies start where \a other is, with the same velocity, drag and radius, and get their own slot when assigned.
+/// This lets EntityManager::create_from_copy copy entities that have bodies.
+VerletBody( const VerletBody &other )
+: _initial( other.state() )
+{}
+
+/// Moves this body to where \a other is, with the same velocity, drag and radius.
+VerletBody& operator=( const VerletBody &other )
+{
+  auto state = other.state();
+  if( _store ) {
+    _store->setPosition( _index, state.position );
+    _store->setPreviousPosition( _index, state.previous_position );
+    _store->setDrag( _index, state.drag );
+    _store->setRadius( _index, state.radius );
+  }
+  else {
+    _initial = state;
+  }
+  return *this;
+}
+
+~VerletBody()
+{
+  if( _store ) {
+    _store->destroy( _index );
+  }
+}
+
 /// Change velocity so the body will move \a amount over one second if there is no friction.
-void nudge(const ci::vec3 &amount) { acceleration += amount * 60.0f; }
+void nudge(const ci::vec3 &amount) { store().setAcceleration( _index, store().acceleration( _index ) + amount * 60.0f ); }
 /// Place the body at a given position with no velocity.
-void place(const ci::vec3 &pos) { position = pos; previous_position = pos; }
+void place(const ci::vec3 &pos) { store().setPosition( _index, pos ); store().setPreviousPosition( _index, pos ); }
 /// Instantaneous velocity, assuming fixed timestep.
-ci::vec3 velocity() const { return position - previous_position; }
+ci::vec3 velocity() const { return position() - previousPosition(); }
+
+ci::vec3  position() const { return store().position( _index ); }
+/// Move the body without changing its previous position, so the move carries into its velocity.
+void      setPosition(const ci::vec3 &pos) { store().setPosition( _index, pos ); }
+ci::vec3  previousPosition() const { return store().previousPosition( _index ); }
+ci::vec3  acceleration() const { return store().acceleration( _index ); }
+float     drag() const { return store().drag( _index ); }
+void      setDrag(float drag) { store().setDrag( _index, drag ); }
+/// Radius of the sphere used when the VerletPhysicsSystem resolves collisions. Bodies with a radius of 0 (the default) don't collide.
+float     radius() const { return store().radius( _index ); }
+void      setRadius(float radius) { store().setRadius( _index, radius ); }
+
+/// This body's slot in the store.
+size_t    index() const { return _index; }
+
+private:
+  /// Set by the VerletPhysicsSystem when the body is assigned.
+  std::shared_ptr<VerletBodyStore>  _store;
+  size_t                            _index = 0;
+  struct State
+  {
+    ci::vec3  position;
+    ci::vec3  previous_position;
+    float     drag = 0.1f;
+    float     radius = 0.0f;
+  };
 
-ci::vec3  position;
-ci::vec3  previous_position;
-ci::vec3  acceleration;
-float      drag = 0.1f;
+  /// Where the body starts, copied into the store when the body is assigned.
+  State                             _initial;
 
+  /// Current state, read from the store once assigned.
+  State state() const
+  {
+    if( ! _store ) {
+      return _initial;
+    }
+    return State{ position(), previousPosition(), drag(), radius() };
+  }
+
+  VerletBodyStore& store() const
+  {
+    assert( _store && "Add and configure a VerletPhysicsSystem before assigning VerletBodies." );
+    return *_store;
+  }
+
+  friend class VerletPhysicsSystem;
+  friend struct VerletDistanceConstraint;
 };
 
-/// A distance constraint between two bodies
+/// A distance constraint between two bodies.
+/// Stored in the bodies' VerletBodyStore, and removed from it as soon as either body is destroyed.
+/// The VerletPhysicsSystem then removes the component from its entity on its next update.
 struct VerletDistanceConstraint
 {
   using BodyHandle = entityx::ComponentHandle<VerletBody>;
 
   VerletDistanceConstraint( BodyHandle a, BodyHandle b )
-  : a( a ),
-    b( b ),
-    distance( glm::distance( a->position, b->position ) )
+  : VerletDistanceConstraint( a, b, glm::distance( a->position(), b->position() ) )
   {}
 
   VerletDistanceConstraint( BodyHandle a, BodyHandle b, float distance )
-  : a( a ),
-    b( b ),
-    distance( distance )
+  : _store( a->_store ),
+    _id( a->store().addConstraint( a->index(), b->index(), distance ) )
+  {
+    assert( a->_store == b->_store && "Constrained bodies must belong to the same VerletPhysicsSystem." );
+  }
+
+  /// Copies add their own constraint between the same bodies, at the same distance.
+  /// This lets EntityManager::create_from_copy copy entities that have constraints. Copies of invalid constraints are invalid.
+  VerletDistanceConstraint( const VerletDistanceConstraint &other )
+  : _store( other._store ),
+    _id( other.copyConstraint() )
   {}
 
-  BodyHandle a, b;
-  float distance;
+  /// Not assignable, since the VerletPhysicsSystem only learns which entity owns a constraint when it is assigned.
+  VerletDistanceConstraint& operator=( const VerletDistanceConstraint & ) = delete;
+
+  ~VerletDistanceConstraint()
+  {
+    _store->removeConstraint( _id );
+  }
+
+  /// False once either body has been destroyed.
+  bool  valid() const { return _store->hasConstraint( _id ); }
+
+  /// Only call while valid().
+  float distance() const { return _store->constraint( _id ).distance; }
+  void  setDistance( float distance ) { _store->setConstraintDistance( _id, distance ); }
+
+private:
+  std::shared_ptr<VerletBodyStore>  _store;
+  VerletBodyStore::ConstraintId     _id;
+
+  VerletBodyStore::ConstraintId copyConstraint() const
+  {
+    if( ! valid() ) {
+      return VerletBodyStore::ConstraintId();
+    }
+    // Copy the constraint out first, since adding one may move the others.
+    auto c = _store->constraint( _id );
+    return _store->addConstraint( c.a, c.b, c.distance );
+  }
+
+  friend class VerletPhysicsSystem;
 };
 
 } // namespace soso
@@ -0,0 +1,166 @@
+//
+//  VerletBodyStore.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "VerletBodyStore.h"
+#include "SimdLanes.h"
+#include <algorithm>
+
+using namespace soso;
+using namespace soso::simd;
+
+size_t VerletBodyStore::create( const ci::vec3 &position, float drag )
+{
+  if( _free_slots.empty() ) {
+    auto begin = capacity();
+    auto end = begin + BlockSize;
+    for( auto *columns : { &_position, &_previous_position, &_acceleration } ) {
+      for( auto &column : *columns ) {
+        column.resize( end, 0.0f );
+      }
+    }
+    _drag.resize( end, 0.0f );
+    _radius.resize( end, 0.0f );
+    _body_constraints.resize( end );
+    // Reversed so the block fills from the front.
+    for( auto slot = end; slot > begin; slot -= 1 ) {
+      _free_slots.push_back( slot - 1 );
+    }
+  }
+
+  auto index = _free_slots.back();
+  _free_slots.pop_back();
+  set( _position, index, position );
+  set( _previous_position, index, position );
+  set( _acceleration, index, ci::vec3( 0 ) );
+  _drag[index] = drag;
+  _radius[index] = 0.0f;
+  return index;
+}
+
+void VerletBodyStore::destroy( size_t index )
+{
+  // Each removal takes the constraint off our list.
+  auto &attached = _body_constraints[index];
+  while( ! attached.empty() ) {
+    auto slot = attached.back();
+    auto id = ConstraintId{ slot, _constraint_slots[slot].generation };
+    _dropped_constraints.push_back( id );
+    removeConstraint( id );
+  }
+
+  // Free slots are still integrated, so leave them at rest where they won't go anywhere.
+  set( _position, index, ci::vec3( 0 ) );
+  set( _previous_position, index, ci::vec3( 0 ) );
+  set( _acceleration, index, ci::vec3( 0 ) );
+  _drag[index] = 0.0f;
+  _radius[index] = 0.0f;
+  _free_slots.push_back( index );
+}
+
+VerletBodyStore::ConstraintId VerletBodyStore::addConstraint( size_t a, size_t b, float distance )
+{
+  uint32_t slot;
+  if( _free_constraint_slots.empty() ) {
+    slot = static_cast<uint32_t>( _constraint_slots.size() );
+    _constraint_slots.push_back( ConstraintSlot{ InvalidIndex, 0 } );
+  }
+  else {
+    slot = _free_constraint_slots.back();
+    _free_constraint_slots.pop_back();
+  }
+
+  _constraint_slots[slot].index = static_cast<uint32_t>( _constraints.size() );
+  _constraints.push_back( Constraint{ static_cast<uint32_t>( a ), static_cast<uint32_t>( b ), distance } );
+  _constraint_owners.push_back( slot );
+  _body_constraints[a].push_back( slot );
+  if( b != a ) {
+    _body_constraints[b].push_back( slot );
+  }
+  _constraints_version += 1;
+
+  return ConstraintId{ slot, _constraint_slots[slot].generation };
+}
+
+void VerletBodyStore::removeConstraint( ConstraintId id )
+{
+  if( ! hasConstraint( id ) ) {
+    return;
+  }
+
+  auto index = _constraint_slots[id.slot].index;
+  auto removed = _constraints[index];
+  detachConstraint( removed.a, id.slot );
+  detachConstraint( removed.b, id.slot );
+
+  // Fill the hole with the last constraint so the array stays dense.
+  auto last = _constraints.size() - 1;
+  if( index != last ) {
+    _constraints[index] = _constraints[last];
+    _constraint_owners[index] = _constraint_owners[last];
+    _constraint_slots[_constraint_owners[index]].index = index;
+  }
+  _constraints.pop_back();
+  _constraint_owners.pop_back();
+
+  // Bump the generation so ids to the removed constraint stay invalid once the slot is reused.
+  _constraint_slots[id.slot].index = InvalidIndex;
+  _constraint_slots[id.slot].generation += 1;
+  _free_constraint_slots.push_back( id.slot );
+  _constraints_version += 1;
+}
+
+void VerletBodyStore::setConstraintDistance( ConstraintId id, float distance )
+{
+  _constraints[_constraint_slots[id.slot].index].distance = distance;
+  _constraints_version += 1;
+}
+
+void VerletBodyStore::detachConstraint( size_t body, uint32_t slot )
+{
+  auto &attached = _body_constraints[body];
+  auto iter = std::find( attached.begin(), attached.end(), slot );
+  if( iter != attached.end() ) {
+    *iter = attached.back();
+    attached.pop_back();
+  }
+}
+
+void VerletBodyStore::integrate( size_t begin, size_t end, float dt_ratio, float dt_squared, bool clear_acceleration )
+{
+  const auto ratio = splat( dt_ratio );
+  const auto dt2 = splat( dt_squared );
+  const auto one = splat( 1.0f );
+  const auto zero = splat( 0.0f );
+
+  for( size_t i = begin; i < end; i += LaneCount ) {
+    // Friction as viscous drag.
+    auto friction = sub( one, loadUnaligned( &_drag[i] ) );
+    for( int c = 0; c < 3; c += 1 ) {
+      auto *p = &_position[c][i];
+      auto *prev = &_previous_position[c][i];
+      auto *a = &_acceleration[c][i];
+
+      auto current = loadUnaligned( p );
+      auto velocity = add( mul( sub( current, loadUnaligned( prev ) ), ratio ), mul( loadUnaligned( a ), dt2 ) );
+      storeUnaligned( p, add( current, mul( velocity, friction ) ) );
+      storeUnaligned( prev, current );
+      // We reset the acceleration so other systems/effects can simply add forces each frame.
+      if( clear_acceleration ) {
+        storeUnaligned( a, zero );
+      }
+    }
+  }
+}
+
+void VerletBodyStore::scaleAccelerations( float amount )
+{
+  for( auto &column : _acceleration ) {
+    for( auto &a : column ) {
+      a *= amount;
+    }
+  }
+}
@@ -0,0 +1,140 @@
+//
+//  VerletBodyStore.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "cinder/Vector.h"
+#include <cstdint>
+#include <vector>
+
+namespace soso {
+
+///
+/// Holds the state of every VerletBody in a world as structure-of-arrays,
+/// so integration can load the same attribute for several bodies into one SIMD register.
+///
+/// Each body keeps its slot for its whole life. Destroyed slots are reset to rest and reused by the next body created.
+/// Slots are allocated in whole blocks, so kernels can run over every block without a scalar tail.
+///
+/// Distance constraints between bodies are stored here too, as a dense array of body slots.
+/// Each body knows its constraints, so destroying a body removes them right away.
+/// Those constraints are then listed as dropped, so whoever owns them can let go of them too.
+///
+class VerletBodyStore
+{
+public:
+  /// Number of slots allocated at a time. A multiple of the widest SIMD width.
+  static const size_t BlockSize = 8;
+
+  VerletBodyStore() = default;
+  VerletBodyStore( const VerletBodyStore & ) = delete;
+  VerletBodyStore& operator=( const VerletBodyStore & ) = delete;
+
+  /// Creates a body at rest at \a position and returns its slot.
+  size_t create( const ci::vec3 &position, float drag );
+  /// Frees a body's slot for reuse and removes any constraints on it.
+  void destroy( size_t index );
+
+  ci::vec3  position( size_t index ) const { return ci::vec3( _position[0][index], _position[1][index], _position[2][index] ); }
+  ci::vec3  previousPosition( size_t index ) const { return ci::vec3( _previous_position[0][index], _previous_position[1][index], _previous_position[2][index] ); }
+  ci::vec3  acceleration( size_t index ) const { return ci::vec3( _acceleration[0][index], _acceleration[1][index], _acceleration[2][index] ); }
+  float     drag( size_t index ) const { return _drag[index]; }
+  /// Collision radius. Bodies with no radius don't collide.
+  float     radius( size_t index ) const { return _radius[index]; }
+
+  void setPosition( size_t index, const ci::vec3 &position ) { set( _position, index, position ); }
+  void setPreviousPosition( size_t index, const ci::vec3 &position ) { set( _previous_position, index, position ); }
+  void setAcceleration( size_t index, const ci::vec3 &acceleration ) { set( _acceleration, index, acceleration ); }
+  void setDrag( size_t index, float drag ) { _drag[index] = drag; }
+  void setRadius( size_t index, float radius ) { _radius[index] = radius; }
+
+  /// Number of slots, including free ones. Always a multiple of BlockSize.
+  size_t capacity() const { return _drag.size(); }
+  /// Number of live bodies.
+  size_t count() const { return capacity() - _free_slots.size(); }
+
+  /// A distance constraint between two bodies, by slot.
+  struct Constraint
+  {
+    uint32_t  a;
+    uint32_t  b;
+    float     distance;
+  };
+
+  /// Refers to a constraint. Once the constraint is removed, the id stays invalid even if its slot is reused.
+  /// Default-constructed ids never refer to a constraint.
+  struct ConstraintId
+  {
+    uint32_t  slot = UINT32_MAX;
+    uint32_t  generation = 0;
+  };
+
+  /// Adds a distance constraint between two live bodies.
+  ConstraintId addConstraint( size_t a, size_t b, float distance );
+  /// Removes a constraint. Does nothing if it was already removed, e.g. along with one of its bodies.
+  void removeConstraint( ConstraintId id );
+  bool hasConstraint( ConstraintId id ) const { return id.slot < _constraint_slots.size() && _constraint_slots[id.slot].generation == id.generation && _constraint_slots[id.slot].index != InvalidIndex; }
+
+  const Constraint& constraint( ConstraintId id ) const { return _constraints[_constraint_slots[id.slot].index]; }
+  void setConstraintDistance( ConstraintId id, float distance );
+
+  /// Constraints removed because one of their bodies was destroyed, since the list was last cleared.
+  const std::vector<ConstraintId>& droppedConstraints() const { return _dropped_constraints; }
+  void clearDroppedConstraints() { _dropped_constraints.clear(); }
+
+  /// Every live constraint, contiguous and in no particular order.
+  const std::vector<Constraint>& constraints() const { return _constraints; }
+  /// Changes whenever constraints are added, removed or modified.
+  uint32_t constraintsVersion() const { return _constraints_version; }
+
+  /// Advances the bodies in [begin, end) by one time-corrected verlet step, optionally clearing their accelerations.
+  /// \a dt_ratio is the current timestep over the previous one. Both bounds must be multiples of BlockSize.
+  void integrate( size_t begin, size_t end, float dt_ratio, float dt_squared, bool clear_acceleration );
+  /// Multiplies every body's acceleration by \a amount.
+  void scaleAccelerations( float amount );
+
+private:
+  using Columns = std::vector<float>[3];
+
+  Columns             _position;
+  Columns             _previous_position;
+  Columns             _acceleration;
+  std::vector<float>  _drag;
+  std::vector<float>  _radius;
+  /// Free slots. The next body created takes the last one.
+  std::vector<size_t> _free_slots;
+
+  static const uint32_t InvalidIndex = UINT32_MAX;
+
+  /// Where a constraint id's constraint is in _constraints.
+  struct ConstraintSlot
+  {
+    uint32_t  index;
+    uint32_t  generation;
+  };
+
+  std::vector<Constraint>             _constraints;
+  /// The slot of each constraint in _constraints, so slots can be updated when constraints move.
+  std::vector<uint32_t>               _constraint_owners;
+  std::vector<ConstraintSlot>         _constraint_slots;
+  std::vector<uint32_t>               _free_constraint_slots;
+  /// The constraint slots attached to each body.
+  std::vector<std::vector<uint32_t>>  _body_constraints;
+  uint32_t                            _constraints_version = 0;
+  std::vector<ConstraintId>           _dropped_constraints;
+
+  void detachConstraint( size_t body, uint32_t slot );
+
+  static void set( Columns &columns, size_t index, const ci::vec3 &value )
+  {
+    columns[0][index] = value.x;
+    columns[1][index] = value.y;
+    columns[2][index] = value.z;
+  }
+};
+
+} // namespace soso
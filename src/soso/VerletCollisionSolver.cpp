@@ -0,0 +1,142 @@
+//
+//  VerletCollisionSolver.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "VerletCollisionSolver.h"
+#include "VerletBodyStore.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace soso;
+using namespace cinder;
+
+namespace {
+
+/// Hashes a cell to a bucket. Distant cells may share a bucket; their bodies are skipped by comparing cells.
+/// x isn't scrambled, so a row of neighboring cells lands in consecutive buckets and is read from one stretch of memory.
+inline uint32_t bucketOf( int32_t x, int32_t y, int32_t z, uint32_t mask )
+{
+  return (static_cast<uint32_t>( x ) + static_cast<uint32_t>( y ) * 73856093u + static_cast<uint32_t>( z ) * 19349663u) & mask;
+}
+
+} // namespace
+
+void VerletCollisionSolver::solve( VerletBodyStore &bodies, WorkerPool *workers )
+{
+  _colliders.clear();
+  auto max_radius = 0.0f;
+  for( size_t i = 0; i < bodies.capacity(); i += 1 ) {
+    // Free slots have no radius, so they are skipped here too.
+    auto radius = bodies.radius( i );
+    if( radius > 0.0f ) {
+      _colliders.push_back( static_cast<uint32_t>( i ) );
+      max_radius = std::max( max_radius, radius );
+    }
+  }
+
+  auto num_colliders = _colliders.size();
+  if( num_colliders < 2 ) {
+    return;
+  }
+
+  // Cells at least as wide as the largest sphere mean overlapping bodies are always in neighboring cells.
+  auto inverse_cell_size = 1.0f / std::max( _cell_size, 2.0f * max_radius );
+  uint32_t num_buckets = 1;
+  while( num_buckets < 2 * num_colliders ) {
+    num_buckets *= 2;
+  }
+  auto mask = num_buckets - 1;
+
+  // Counting sort colliders into their buckets.
+  _sorted.resize( num_colliders );
+  _buckets.resize( num_colliders );
+  _bucket_starts.assign( num_buckets + 1, 0 );
+  for( size_t k = 0; k < num_colliders; k += 1 ) {
+    auto i = _colliders[k];
+    // Fill in the entry at k for now; it moves to its sorted place below.
+    auto &entry = _sorted[k];
+    entry.position = bodies.position( i );
+    entry.radius = bodies.radius( i );
+    entry.slot = i;
+    for( int c = 0; c < 3; c += 1 ) {
+      entry.cell[c] = static_cast<int32_t>( std::floor( entry.position[c] * inverse_cell_size ) );
+    }
+    _buckets[k] = bucketOf( entry.cell[0], entry.cell[1], entry.cell[2], mask );
+    _bucket_starts[_buckets[k] + 1] += 1;
+  }
+  for( size_t b = 0; b < num_buckets; b += 1 ) {
+    _bucket_starts[b + 1] += _bucket_starts[b];
+  }
+  _unsorted.swap( _sorted );
+  _sorted.resize( num_colliders );
+  auto next = _bucket_starts;
+  for( size_t k = 0; k < num_colliders; k += 1 ) {
+    _sorted[next[_buckets[k]]++] = _unsorted[k];
+  }
+
+  _corrections.resize( num_colliders );
+  auto num_tasks = (num_colliders + TaskSize - 1) / TaskSize;
+  if( workers && num_tasks > 1 ) {
+    workers->parallelFor( num_tasks, [this, num_colliders, mask] (size_t task) {
+      auto begin = task * TaskSize;
+      collide( begin, std::min( begin + TaskSize, num_colliders ), mask );
+    } );
+  }
+  else {
+    collide( 0, num_colliders, mask );
+  }
+
+  for( size_t k = 0; k < num_colliders; k += 1 ) {
+    auto &entry = _sorted[k];
+    bodies.setPosition( entry.slot, entry.position + _corrections[k] );
+  }
+}
+
+void VerletCollisionSolver::collide( size_t begin, size_t end, uint32_t mask )
+{
+  for( auto k = begin; k < end; k += 1 ) {
+    auto &body = _sorted[k];
+    auto correction = vec3( 0 );
+
+    for( int32_t dz = -1; dz <= 1; dz += 1 ) {
+      for( int32_t dy = -1; dy <= 1; dy += 1 ) {
+        for( int32_t dx = -1; dx <= 1; dx += 1 ) {
+          int32_t cell[3] = { body.cell[0] + dx, body.cell[1] + dy, body.cell[2] + dz };
+          auto bucket = bucketOf( cell[0], cell[1], cell[2], mask );
+
+          for( auto s = _bucket_starts[bucket]; s < _bucket_starts[bucket + 1]; s += 1 ) {
+            auto &other = _sorted[s];
+            // Skip ourselves, and bodies from other cells that share the bucket so no pair is counted twice.
+            if( s == k || other.cell[0] != cell[0] || other.cell[1] != cell[1] || other.cell[2] != cell[2] ) {
+              continue;
+            }
+            auto delta = body.position - other.position;
+            auto min_distance = body.radius + other.radius;
+            auto distance2 = glm::length2( delta );
+            if( distance2 >= min_distance * min_distance ) {
+              continue;
+            }
+
+            // Each body of an overlapping pair moves half the overlap, away from the other.
+            auto distance = std::sqrt( distance2 );
+            if( distance > std::numeric_limits<float>::epsilon() ) {
+              correction += delta * ((min_distance - distance) * 0.5f / distance);
+            }
+            else {
+              // Separate coincident bodies along a fixed axis, by slot, so the pair moves in opposite directions.
+              correction += vec3( body.slot < other.slot ? 0.5f : -0.5f, 0, 0 ) * min_distance;
+            }
+          }
+        }
+      }
+    }
+
+    _corrections[k] = correction;
+  }
+}
@@ -0,0 +1,69 @@
+//
+//  VerletCollisionSolver.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "cinder/Vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace soso {
+
+class VerletBodyStore;
+class WorkerPool;
+
+///
+/// Pushes overlapping verlet bodies apart, treating each body with a radius as a sphere.
+///
+/// Bodies are bucketed into a uniform spatial hash, rebuilt with a counting sort each solve,
+/// so each body only tests the bodies in its own and neighboring cells.
+/// Every body's correction is computed from the positions before the solve and then applied together,
+/// so bodies can be checked in parallel without write conflicts and serial and parallel solves give identical results.
+///
+class VerletCollisionSolver
+{
+public:
+  /// Resolves overlaps between all bodies with a radius, spreading the work across workers if given.
+  void solve( VerletBodyStore &bodies, WorkerPool *workers );
+
+  /// Use cells at least this large. Cells are never smaller than the largest body's diameter, which is also the default.
+  void  setCellSize( float size ) { _cell_size = size; }
+  float cellSize() const { return _cell_size; }
+
+  /// Number of bodies a worker checks per task.
+  static const size_t TaskSize = 1024;
+
+private:
+  /// A collider's state, copied in bucket order so checking a bucket reads contiguous memory.
+  struct Entry
+  {
+    ci::vec3  position;
+    float     radius;
+    int32_t   cell[3];
+    uint32_t  slot;
+  };
+
+  float                   _cell_size = 0.0f;
+
+  /// Slots of the bodies that collide, i.e. have a radius.
+  std::vector<uint32_t>   _colliders;
+  /// Start of each hash bucket in _sorted, plus one past the end.
+  std::vector<uint32_t>   _bucket_starts;
+  /// Colliders sorted by hash bucket, and scratch space for sorting them.
+  std::vector<Entry>      _sorted;
+  std::vector<Entry>      _unsorted;
+  /// Each collider's hash bucket.
+  std::vector<uint32_t>   _buckets;
+  /// How far each sorted collider will be moved.
+  std::vector<ci::vec3>   _corrections;
+
+  /// Sums the corrections for the sorted colliders [begin, end).
+  void collide( size_t begin, size_t end, uint32_t mask );
+};
+
+} // namespace soso
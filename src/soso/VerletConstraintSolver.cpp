@@ -0,0 +1,114 @@
+//
+//  VerletConstraintSolver.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "VerletConstraintSolver.h"
+#include "VerletBodyStore.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace soso;
+using namespace cinder;
+
+namespace {
+
+/// Colors tracked per body. Constraints that can't get one go in a final batch that is solved serially.
+const size_t MaxColors = 64;
+
+} // namespace
+
+void VerletConstraintSolver::color( const VerletBodyStore &bodies )
+{
+  auto &constraints = bodies.constraints();
+  _body_colors.assign( bodies.capacity(), 0 );
+  _constraint_colors.resize( constraints.size() );
+
+  std::vector<size_t> counts( MaxColors + 1, 0 );
+  for( size_t i = 0; i < constraints.size(); i += 1 ) {
+    auto &c = constraints[i];
+    auto used = _body_colors[c.a] | _body_colors[c.b];
+    size_t color = 0;
+    while( color < MaxColors && (used & (uint64_t( 1 ) << color)) ) {
+      color += 1;
+    }
+    if( color < MaxColors ) {
+      _body_colors[c.a] |= uint64_t( 1 ) << color;
+      _body_colors[c.b] |= uint64_t( 1 ) << color;
+    }
+    _constraint_colors[i] = static_cast<uint8_t>( color );
+    counts[color] += 1;
+  }
+
+  // Drop unused colors from the end, so we don't wait on empty batches.
+  auto num_colors = counts.size();
+  while( num_colors > 0 && counts[num_colors - 1] == 0 ) {
+    num_colors -= 1;
+  }
+
+  _color_offsets.assign( num_colors + 1, 0 );
+  for( size_t color = 0; color < num_colors; color += 1 ) {
+    _color_offsets[color + 1] = _color_offsets[color] + counts[color];
+  }
+
+  // Scatter into color order, keeping the store's order within each color.
+  _colored.resize( constraints.size() );
+  auto next = _color_offsets;
+  for( size_t i = 0; i < constraints.size(); i += 1 ) {
+    _colored[next[_constraint_colors[i]]++] = constraints[i];
+  }
+
+  _colored_store = &bodies;
+  _colored_version = bodies.constraintsVersion();
+}
+
+void VerletConstraintSolver::solve( VerletBodyStore &bodies, int iterations, WorkerPool *workers )
+{
+  if( _colored_store != &bodies || _colored_version != bodies.constraintsVersion() ) {
+    color( bodies );
+  }
+
+  auto *data = _colored.data();
+  auto num_colors = _color_offsets.size() - 1;
+  for( int i = 0; i < iterations; i += 1 ) {
+    for( size_t color = 0; color < num_colors; color += 1 ) {
+      auto begin = _color_offsets[color];
+      auto end = _color_offsets[color + 1];
+      auto num_tasks = (end - begin + TaskSize - 1) / TaskSize;
+      // The overflow batch may share bodies, so it always runs serially.
+      if( workers && num_tasks > 1 && color < MaxColors ) {
+        workers->parallelFor( num_tasks, [&bodies, data, begin, end] (size_t task) {
+          auto task_begin = begin + task * TaskSize;
+          solveRange( bodies, data + task_begin, data + std::min( task_begin + TaskSize, end ) );
+        } );
+      }
+      else {
+        solveRange( bodies, data + begin, data + end );
+      }
+    }
+  }
+}
+
+void VerletConstraintSolver::solveRange( VerletBodyStore &bodies, const Constraint *begin, const Constraint *end )
+{
+  for( auto *c = begin; c != end; ++c ) {
+    auto position_a = bodies.position( c->a );
+    auto position_b = bodies.position( c->b );
+
+    auto center = (position_a + position_b) / 2.0f;
+    auto delta = position_a - position_b;
+    auto len = glm::length( delta );
+    if( len < std::numeric_limits<float>::epsilon() ) {
+      // Push coincident bodies apart along a fixed axis, so the result doesn't depend on which thread ran first.
+      delta = vec3( 1, 0, 0 );
+      len = 1.0f;
+    }
+    delta *= c->distance / (len * 2.0f); // get half delta
+    bodies.setPosition( c->a, center + delta );
+    bodies.setPosition( c->b, center - delta );
+  }
+}
@@ -0,0 +1,57 @@
+//
+//  VerletConstraintSolver.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include "VerletBodyStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace soso {
+
+class WorkerPool;
+
+///
+/// Relaxes the distance constraints in a VerletBodyStore.
+///
+/// Each iteration visits every constraint once, so corrections propagate along chains over successive iterations.
+/// Constraints are grouped by graph coloring so no two constraints of the same color share a body.
+/// Each color can then be solved in parallel without write conflicts, and because colors are always solved in the same order,
+/// serial and parallel solves give identical results.
+/// Coloring is redone only when the store's constraints change.
+///
+class VerletConstraintSolver
+{
+public:
+  using Constraint = VerletBodyStore::Constraint;
+
+  /// Relaxes every constraint \a iterations times, spreading each color across workers if given.
+  void solve( VerletBodyStore &bodies, int iterations, WorkerPool *workers );
+
+  /// Number of constraints a worker solves per task.
+  static const size_t TaskSize = 1024;
+
+private:
+  /// The store's constraints, sorted by color.
+  std::vector<Constraint> _colored;
+  /// Start of each color in _colored, plus one past the end.
+  std::vector<size_t>     _color_offsets;
+  /// The store and version of its constraints that we last colored.
+  const VerletBodyStore   *_colored_store = nullptr;
+  uint32_t                _colored_version = 0;
+
+  /// Scratch space for coloring: the colors already used by each body's constraints, and each constraint's color.
+  std::vector<uint64_t>   _body_colors;
+  std::vector<uint8_t>    _constraint_colors;
+
+  /// Greedily assigns each constraint the lowest color not used by either of its bodies.
+  void color( const VerletBodyStore &bodies );
+  static void solveRange( VerletBodyStore &bodies, const Constraint *begin, const Constraint *end );
+};
+
+} // namespace soso
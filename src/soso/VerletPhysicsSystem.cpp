@@ -7,70 +7,132 @@
 
 #include "VerletPhysicsSystem.h"
 #include "VerletBody.h"
+#include "WorkerPool.h"
+#include <cmath>
 
 #include "cinder/Log.h"
-#include "cinder/Rand.h"
 
 using namespace soso;
 using namespace cinder;
 using namespace entityx;
 
-void VerletPhysicsSystem::update( EntityManager &entities, EventManager &events, TimeDelta dt )
+void VerletPhysicsSystem::configure( EventManager &events )
 {
-  ComponentHandle<VerletBody> body;
-  for( auto __unused e : entities.entities_with_components( body ) )
-  {
-    auto &b = *body.get();
-    auto current = b.position;
-    auto velocity = (b.position - b.previous_position) * static_cast<float>((dt / previous_dt)) + b.acceleration * static_cast<float>(dt * dt);
-    // Friction as viscous drag.
-    velocity *= (1.0 - b.drag);
-
-    /*
-    // Friction as a fixed-ish force.
-    // Perhaps do some kind of ground test and apply when things are on ground.
-    auto l2 = glm::length2(velocity);
-    if (l2 > 0.0f) {
-      auto len = std::sqrt(l2);
-      auto friction = (velocity / len) * std::min(b.friction, len);
-      velocity -= friction;
-    }
-    */
+  events.subscribe<ComponentAddedEvent<VerletBody>>( *this );
+  events.subscribe<ComponentAddedEvent<VerletDistanceConstraint>>( *this );
+}
 
-    b.position += velocity;
-    b.previous_position = current;
+void VerletPhysicsSystem::receive( const ComponentAddedEvent<VerletBody> &event )
+{
+  auto body = event.component;
+  body->_store = _bodies;
+  auto &initial = body->_initial;
+  body->_index = _bodies->create( initial.position, initial.drag );
+  _bodies->setPreviousPosition( body->_index, initial.previous_position );
+  _bodies->setRadius( body->_index, initial.radius );
+}
 
-    // We reset the acceleration so other systems/effects can simply add forces each frame.
-    // TODO: consider alternative approaches to this.
-    b.acceleration = vec3(0);
-    previous_dt = dt;
+void VerletPhysicsSystem::receive( const ComponentAddedEvent<VerletDistanceConstraint> &event )
+{
+  if( ! event.component->valid() ) {
+    return;
+  }
+  auto slot = event.component->_id.slot;
+  if( slot >= _constraint_entities.size() ) {
+    _constraint_entities.resize( slot + 1 );
   }
+  _constraint_entities[slot] = event.entity;
+}
 
-  // solve constraints
-  ComponentHandle<VerletDistanceConstraint> constraint;
-  const auto constraint_iterations = 2;
-  for( auto __unused e : entities.entities_with_components( constraint ) )
-  {
-    if( (! constraint->a.valid()) || (! constraint->b.valid()) ) {
-      // would be cooler if the bodies knew about all constraints on them so this couldn't happen.
-      constraint.remove();
+void VerletPhysicsSystem::removeDroppedConstraints()
+{
+  for( auto &id : _bodies->droppedConstraints() ) {
+    if( id.slot >= _constraint_entities.size() ) {
       continue;
     }
-
-    for( int i = 0; i < constraint_iterations; i += 1 ) {
-      auto &a = *constraint->a.get();
-      auto &b = *constraint->b.get();
-
-      auto center = (a.position + b.position) / 2.0f;
-      auto delta = a.position - b.position;
-      auto len = glm::length( delta );
-      if( len < std::numeric_limits<float>::epsilon() ) {
-        delta = randVec3();
-        len = 1.0f;
-      }
-      delta *= constraint->distance / (len * 2.0f); // get half delta
-      a.position = center + delta;
-      b.position = center - delta;
+    auto entity = _constraint_entities[id.slot];
+    if( ! entity.valid() || ! entity.has_component<VerletDistanceConstraint>() ) {
+      continue;
+    }
+    // The entity may have been given a newer constraint since; only remove the one that was dropped.
+    auto &current = entity.component<VerletDistanceConstraint>()->_id;
+    if( current.slot == id.slot && current.generation == id.generation ) {
+      entity.remove<VerletDistanceConstraint>();
     }
   }
+  _bodies->clearDroppedConstraints();
+}
+
+void VerletPhysicsSystem::setFixedTimestep( TimeDelta step, int substeps )
+{
+  _fixed_step = std::max( step, 0.0 );
+  _substeps = std::max( substeps, 1 );
+  _accumulator = 0;
+  _held_updates = 0;
+}
+
+void VerletPhysicsSystem::update( EntityManager &entities, EventManager &events, TimeDelta dt )
+{
+  if( _parallel && ! _worker_pool ) {
+    _worker_pool = std::make_shared<WorkerPool>();
+  }
+  auto *workers = _parallel ? _worker_pool.get() : nullptr;
+
+  removeDroppedConstraints();
+
+  if( ! isFixedTimestep() ) {
+    step( dt, true, workers );
+    return;
+  }
+
+  _accumulator += dt;
+  auto steps = std::min( static_cast<int>( _accumulator / _fixed_step ), std::max( _max_steps, 1 ) );
+  if( steps == 0 ) {
+    // Hold on to this update's forces until the next step.
+    _held_updates += 1;
+    return;
+  }
+
+  if( _held_updates > 0 ) {
+    // Forces are added fresh each update, so average the ones that piled up while we waited for a whole step.
+    _bodies->scaleAccelerations( 1.0f / (_held_updates + 1) );
+    _held_updates = 0;
+  }
+
+  // Forces applied this update act over every substep we take.
+  auto substep = _fixed_step / _substeps;
+  auto num_substeps = steps * _substeps;
+  for( int i = 0; i < num_substeps; i += 1 ) {
+    step( substep, i == num_substeps - 1, workers );
+  }
+
+  _accumulator -= steps * _fixed_step;
+  if( _accumulator >= _fixed_step ) {
+    // Hit the catch-up limit; drop the time we couldn't simulate.
+    _accumulator = std::fmod( _accumulator, _fixed_step );
+  }
+}
+
+void VerletPhysicsSystem::step( TimeDelta dt, bool last_step, WorkerPool *workers )
+{
+  // Free slots sit at rest, so integrate every block rather than skipping them.
+  auto dt_ratio = static_cast<float>( dt / previous_dt );
+  auto dt_squared = static_cast<float>( dt * dt );
+  auto num_bodies = _bodies->capacity();
+  auto num_tasks = (num_bodies + IntegrationTaskSize - 1) / IntegrationTaskSize;
+  if( workers && num_tasks > 1 ) {
+    workers->parallelFor( num_tasks, [this, num_bodies, dt_ratio, dt_squared, last_step] (size_t task) {
+      auto begin = task * IntegrationTaskSize;
+      _bodies->integrate( begin, std::min( begin + IntegrationTaskSize, num_bodies ), dt_ratio, dt_squared, last_step );
+    } );
+  }
+  else {
+    _bodies->integrate( 0, num_bodies, dt_ratio, dt_squared, last_step );
+  }
+  previous_dt = dt;
+
+  _constraints.solve( *_bodies, _constraint_iterations, workers );
+  if( _collisions ) {
+    _collision_solver.solve( *_bodies, workers );
+  }
 }
@@ -8,19 +8,103 @@
 #pragma once
 
 #include "entityx/System.h"
+#include "VerletBodyStore.h"
+#include "VerletCollisionSolver.h"
+#include "VerletConstraintSolver.h"
+#include <memory>
+#include <vector>
 
 namespace soso {
 
+struct VerletBody;
+struct VerletDistanceConstraint;
+class WorkerPool;
+
 ///
 /// Performs time-corrected verlet integration.
 ///
-class VerletPhysicsSystem : public entityx::System<VerletPhysicsSystem>
+/// Bodies are stored as structure-of-arrays in the system's VerletBodyStore and integrated several at a time with SIMD instructions.
+/// Distance constraints are then relaxed together over a number of iterations, see VerletConstraintSolver.
+/// Optionally, bodies with a radius are then pushed out of each other, see VerletCollisionSolver.
+///
+/// By default the world advances by one variable step per update. In fixed timestep mode, update time is accumulated
+/// and the world advances in whole fixed steps, each split into substeps that integrate and then solve constraints.
+/// Results are then independent of frame rate, and short substeps keep stiff constraints stable with few iterations.
+/// Forces added during updates too short for a whole step are held and averaged into the next step.
+///
+/// Integration and the constraint solve can optionally be spread across worker threads.
+/// The parallel update performs the same operations in the same order per body, so its results match the serial update.
+///
+class VerletPhysicsSystem : public entityx::System<VerletPhysicsSystem>, public entityx::Receiver<VerletPhysicsSystem>
 {
 public:
+  void configure( entityx::EventManager &events ) override;
   void update( entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt ) override;
 
+  /// Hooks new VerletBodies up to our store.
+  void receive( const entityx::ComponentAddedEvent<VerletBody> &event );
+  /// Remembers which entity each constraint belongs to, so it can be removed once one of its bodies is destroyed.
+  void receive( const entityx::ComponentAddedEvent<VerletDistanceConstraint> &event );
+
+  /// Advance in fixed steps of \a step seconds, each split into \a substeps, carrying leftover time to the next update.
+  /// Pass a step of 0 to go back to one variable step per update.
+  void setFixedTimestep( entityx::TimeDelta step, int substeps = 1 );
+  bool isFixedTimestep() const { return _fixed_step > 0; }
+  /// The most fixed steps taken in one update. Time beyond that is dropped, so a slow frame doesn't lead to ever slower frames.
+  void setMaxStepsPerUpdate( int steps ) { _max_steps = steps; }
+  /// Fraction of a fixed step accumulated but not yet simulated, e.g. for TransformSystem::interpolatedWorldTransform.
+  float interpolationAlpha() const { return isFixedTimestep() ? static_cast<float>( _accumulator / _fixed_step ) : 1.0f; }
+
+  /// Number of times every constraint is relaxed per step, or per substep in fixed timestep mode. More iterations make long chains stiffer.
+  void setConstraintIterations( int iterations ) { _constraint_iterations = iterations; }
+  int  constraintIterations() const { return _constraint_iterations; }
+
+  /// Resolve overlaps between bodies with a radius after solving constraints each step. Off by default.
+  void setCollisions( bool collisions ) { _collisions = collisions; }
+  bool hasCollisions() const { return _collisions; }
+  /// Size of the spatial hash cells used to find colliding bodies. Defaults to the largest body's diameter.
+  void setCollisionCellSize( float size ) { _collision_solver.setCellSize( size ); }
+
+  /// Switch between updating on the calling thread or across a pool of worker threads.
+  void setParallel( bool parallel ) { _parallel = parallel; }
+  bool isParallel() const { return _parallel; }
+  /// Use a specific pool for parallel updates, e.g. to share worker threads between systems.
+  /// If none is provided, one is created the first time a parallel update runs.
+  void setWorkerPool( const std::shared_ptr<WorkerPool> &pool ) { _worker_pool = pool; }
+
+  /// Number of bodies a worker integrates per task. A multiple of VerletBodyStore::BlockSize.
+  static const size_t IntegrationTaskSize = 4096;
+
 private:
-  entityx::TimeDelta  previous_dt = 1.0 / 60.0;
+  /// Removes the components of constraints that were dropped along with one of their bodies.
+  void removeDroppedConstraints();
+
+  /// Integrates every body by dt, relaxes constraints and resolves collisions. Clears accelerations if this is the last step of the update.
+  void step( entityx::TimeDelta dt, bool last_step, WorkerPool *workers );
+
+  /// Shared with every body so bodies can outlive the system during teardown.
+  std::shared_ptr<VerletBodyStore>  _bodies = std::make_shared<VerletBodyStore>();
+  entityx::TimeDelta                previous_dt = 1.0 / 60.0;
+  /// The entity of each constraint, by constraint slot.
+  std::vector<entityx::Entity>      _constraint_entities;
+
+  /// Fixed step length, or 0 for variable steps.
+  entityx::TimeDelta                _fixed_step = 0;
+  int                               _substeps = 1;
+  int                               _max_steps = 4;
+  /// Time not yet simulated in fixed timestep mode.
+  entityx::TimeDelta                _accumulator = 0;
+  /// Updates since the last step whose forces are still waiting to be applied.
+  int                               _held_updates = 0;
+
+  VerletConstraintSolver            _constraints;
+  int                               _constraint_iterations = 2;
+
+  VerletCollisionSolver             _collision_solver;
+  bool                              _collisions = false;
+
+  bool                              _parallel = false;
+  std::shared_ptr<WorkerPool>       _worker_pool;
 };
 
 } // namespace soso
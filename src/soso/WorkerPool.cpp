@@ -0,0 +1,152 @@
+//
+//  WorkerPool.cpp
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#include "WorkerPool.h"
+
+using namespace soso;
+
+size_t WorkerPool::defaultWorkerCount()
+{
+  auto hardware_threads = std::thread::hardware_concurrency();
+  return (hardware_threads > 1) ? hardware_threads - 1 : 0;
+}
+
+WorkerPool::WorkerPool( size_t num_workers )
+{
+  // One queue per worker, plus one for the calling thread.
+  for( size_t i = 0; i <= num_workers; i += 1 ) {
+    _queues.emplace_back( new Queue );
+  }
+
+  for( size_t i = 0; i < num_workers; i += 1 ) {
+    _workers.emplace_back( [this, i] { workerLoop( i ); } );
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    _stopping = true;
+  }
+  _work_ready.notify_all();
+
+  for( auto &worker : _workers ) {
+    worker.join();
+  }
+}
+
+void WorkerPool::parallelFor( size_t count, const std::function<void (size_t)> &fn )
+{
+  if( count == 0 ) {
+    return;
+  }
+
+  auto caller_queue = _workers.size();
+  if( _workers.empty() || count == 1 ) {
+    for( size_t i = 0; i < count; i += 1 ) {
+      fn( i );
+    }
+    return;
+  }
+
+  // Deal out contiguous blocks so neighboring tasks tend to run on the same thread.
+  auto num_queues = _queues.size();
+  for( size_t q = 0; q < num_queues; q += 1 ) {
+    auto begin = count * q / num_queues;
+    auto end = count * (q + 1) / num_queues;
+    std::lock_guard<std::mutex> lock( _queues[q]->mutex );
+    for( auto i = begin; i < end; i += 1 ) {
+      _queues[q]->tasks.push_back( i );
+    }
+  }
+  _remaining_tasks = count;
+
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    _fn = &fn;
+    _active_workers = _workers.size();
+    _generation += 1;
+  }
+  _work_ready.notify_all();
+
+  runTasks( caller_queue, fn );
+
+  // Wait for the last tasks to finish and for every worker to let go of fn.
+  std::unique_lock<std::mutex> lock( _mutex );
+  _work_done.wait( lock, [this] { return _active_workers == 0; } );
+  _fn = nullptr;
+}
+
+void WorkerPool::workerLoop( size_t queue_index )
+{
+  size_t generation = 0;
+  while( true )
+  {
+    const std::function<void (size_t)> *fn = nullptr;
+    {
+      std::unique_lock<std::mutex> lock( _mutex );
+      _work_ready.wait( lock, [this, generation] { return _stopping || _generation != generation; } );
+      if( _stopping ) {
+        return;
+      }
+      generation = _generation;
+      fn = _fn;
+    }
+
+    runTasks( queue_index, *fn );
+
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _active_workers -= 1;
+    }
+    _work_done.notify_all();
+  }
+}
+
+void WorkerPool::runTasks( size_t queue_index, const std::function<void (size_t)> &fn )
+{
+  size_t task;
+  while( _remaining_tasks > 0 )
+  {
+    if( takeTask( queue_index, &task ) ) {
+      fn( task );
+      _remaining_tasks -= 1;
+    }
+    else {
+      // Everything has been taken; the remaining tasks are running on other threads.
+      break;
+    }
+  }
+}
+
+bool WorkerPool::takeTask( size_t queue_index, size_t *task )
+{
+  {
+    auto &own = *_queues[queue_index];
+    std::lock_guard<std::mutex> lock( own.mutex );
+    if( ! own.tasks.empty() ) {
+      *task = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  // Steal from the front of another queue, starting with our neighbor so thieves spread out.
+  auto num_queues = _queues.size();
+  for( size_t offset = 1; offset < num_queues; offset += 1 ) {
+    auto &other = *_queues[(queue_index + offset) % num_queues];
+    std::lock_guard<std::mutex> lock( other.mutex );
+    if( ! other.tasks.empty() ) {
+      *task = other.tasks.front();
+      other.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
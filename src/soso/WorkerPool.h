@@ -0,0 +1,75 @@
+//
+//  WorkerPool.h
+//
+//  Created by Soso Limited on 10/16/26.
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace soso {
+
+///
+/// A fixed set of worker threads for splitting up data-parallel work.
+///
+/// Work is dealt out to every participating thread in contiguous blocks.
+/// Threads that run out of work steal from the others, so tasks of very different sizes still balance.
+/// The thread calling parallelFor participates as well.
+///
+class WorkerPool
+{
+public:
+  /// Creates a pool with \a num_workers threads in addition to the calling thread.
+  explicit WorkerPool( size_t num_workers = defaultWorkerCount() );
+  ~WorkerPool();
+
+  WorkerPool( const WorkerPool & ) = delete;
+  WorkerPool& operator=( const WorkerPool & ) = delete;
+
+  /// Calls fn(i) for every i in [0, count) and returns once all calls have finished.
+  /// Calls may happen in any order and on any thread. Don't call parallelFor from inside fn.
+  void parallelFor( size_t count, const std::function<void (size_t)> &fn );
+
+  /// Returns the number of worker threads, not counting the calling thread.
+  size_t numWorkers() const { return _workers.size(); }
+
+  /// One worker per hardware thread, leaving one for the thread that calls parallelFor.
+  static size_t defaultWorkerCount();
+
+private:
+  /// Task indices waiting to be run by one thread. Owners pop from the back; thieves take from the front.
+  struct Queue
+  {
+    std::mutex          mutex;
+    std::deque<size_t>  tasks;
+  };
+
+  std::vector<std::thread>              _workers;
+  std::vector<std::unique_ptr<Queue>>   _queues;
+
+  std::mutex                            _mutex;
+  std::condition_variable               _work_ready;
+  std::condition_variable               _work_done;
+  const std::function<void (size_t)>    *_fn = nullptr;
+  size_t                                _generation = 0;
+  size_t                                _active_workers = 0;
+  bool                                  _stopping = false;
+
+  std::atomic<size_t>                   _remaining_tasks{ 0 };
+
+  void workerLoop( size_t queue_index );
+  /// Runs tasks from our own queue, then from the others, until there are none left to take.
+  void runTasks( size_t queue_index, const std::function<void (size_t)> &fn );
+  bool takeTask( size_t queue_index, size_t *task );
+};
+
+} // namespace soso